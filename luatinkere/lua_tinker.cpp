@@ -11,6 +11,9 @@
 #include<string>
 #include<cstring>
 #include<algorithm>
+#include<atomic>
+#include<mutex>
+#include<deque>
 #if defined(_MSC_VER)
 #define I64_FMT "I64"
 #elif defined(__APPLE__) 
@@ -22,17 +25,18 @@
 
 namespace lua_tinker
 {
-	const char* S_SHARED_PTR_NAME = "__shared_ptr";
+	const char* const S_SHARED_PTR_NAME = "__shared_ptr";
 
 
-	error_call_back_fn g_error_call_back;
+	//init of states on different threads all write it
+	std::atomic<error_call_back_fn> g_error_call_back(nullptr);
 	error_call_back_fn get_error_callback()
 	{
-		return g_error_call_back;
+		return g_error_call_back.load(std::memory_order_relaxed);
 	}
 	void set_error_callback(error_call_back_fn fn)
 	{
-		g_error_call_back = fn;
+		g_error_call_back.store(fn, std::memory_order_relaxed);
 	}
 
 }
@@ -48,9 +52,16 @@ struct lua_ext_value
 	lua_State * m_L;
 	typedef std::vector<lua_tinker::Lua_Close_CallBack_Func> CLOSE_CALLBACK_VEC;
 	CLOSE_CALLBACK_VEC m_vecCloseCallBack;
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-	lua_tinker::detail::InheritMap m_inherit_map;
-#endif
+	lua_tinker::detail::inherit_cast_table m_inherit_cast;
+	//refcount of lua_ref_base, indexed by the registry ref
+	std::vector<int> m_ref_count;
+	//lua name of each type registered in this state, indexed by type_idx, nullptr if not registered
+	std::vector<const char*> m_type_names;
+	//storage of m_type_names, never erased so a returned name live as long as the state
+	std::deque<std::string> m_type_name_pool;
+	//nullptr use the global one
+	lua_tinker::error_call_back_fn m_error_call_back = nullptr;
+	lua_tinker::state_stats m_stats;
 	lua_ext_value(lua_State *L)
 		:m_L(L)
 	{
@@ -64,20 +75,88 @@ struct lua_ext_value
 		}
 	}
 };
-static const char* s_lua_ext_value_name = "___lua_ext_value";
+static const char s_lua_ext_value_key = 0;
+//class_meta[&s_parent_key] = class_meta.__parent, class_meta[&s_multi_parent_key] = class_meta.__multi_parent
+//only these keys are read, a script assign class_meta.__parent is ignored, use class_inh or lua_create_class
+static const char s_parent_key = 0;
+static const char s_multi_parent_key = 0;
 
-void lua_tinker::register_lua_close_callback(lua_State* L, Lua_Close_CallBack_Func&& callback_func)
+static lua_ext_value* get_lua_ext_value_in_registry(lua_State* L)
 {
-	detail::stack_scope_exit scope_exit(L);
-	if (lua_getglobal(L, s_lua_ext_value_name) != LUA_TUSERDATA)
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_lua_ext_value_key) != LUA_TUSERDATA)
 	{
-		lua_pop(L,1); //pop getglobal
-		print_error(L, "can't find lua_ext_value");
-		return;
+		lua_pop(L, 1);
+		lua_tinker::print_error(L, "can't find lua_ext_value");
+		return nullptr;
+	}
+	lua_ext_value* p_lua_ext_val = (lua_ext_value*)lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return p_lua_ext_val;
+}
+
+static lua_ext_value* get_lua_ext_value(lua_State* L)
+{
+#ifdef LUATINKER_USE_EXTRASPACE
+	//lua never zero the extraspace, a thread created before init hold garbage here and can't be told apart in release
+	lua_ext_value* p_lua_ext_val = *(lua_ext_value**)lua_getextraspace(L);
+#ifdef _DEBUG
+	if (p_lua_ext_val != get_lua_ext_value_in_registry(L))
+	{
+		lua_tinker::print_error(L, "lua_ext_value not in extraspace, the thread is created before lua_tinker::init");
+		return nullptr;
 	}
+#endif
+	return p_lua_ext_val;
+#else
+	return get_lua_ext_value_in_registry(L);
+#endif
+}
 
+//no lookup of the context on every call until some state set its own callback
+static std::atomic<bool> s_has_state_error_call_back(false);
+
+lua_tinker::error_call_back_fn lua_tinker::get_error_callback(lua_State* L)
+{
+#ifndef LUATINKER_USE_EXTRASPACE
+	if (s_has_state_error_call_back.load(std::memory_order_relaxed) == false)
+		return get_error_callback();
+#endif
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr || p_lua_ext_val->m_error_call_back == nullptr)
+		return get_error_callback();
+	return p_lua_ext_val->m_error_call_back;
+}
+
+void lua_tinker::set_error_callback(lua_State* L, error_call_back_fn fn)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr)
+		return;
+	p_lua_ext_val->m_error_call_back = fn;
+	if (fn != nullptr)
+		s_has_state_error_call_back.store(true, std::memory_order_relaxed);
+}
+
+const lua_tinker::state_stats* lua_tinker::get_state_stats(lua_State* L)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr)
+		return nullptr;
+	return &p_lua_ext_val->m_stats;
+}
+
+void lua_tinker::detail::count_call_error(lua_State* L)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val != nullptr)
+		++p_lua_ext_val->m_stats.m_nCallError;
+}
 
-	lua_ext_value* p_lua_ext_val = detail::user2type<lua_ext_value*>(L, -1);
+void lua_tinker::register_lua_close_callback(lua_State* L, Lua_Close_CallBack_Func&& callback_func)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr)
+		return;
 	p_lua_ext_val->m_vecCloseCallBack.emplace_back(callback_func);
 }
 
@@ -93,7 +172,14 @@ static void init_close_callback(lua_State *L)
 		lua_rawset(L, -3);
 		lua_setmetatable(L, -2);
 	}
-	lua_setglobal(L, s_lua_ext_value_name); //pop
+#ifdef LUATINKER_USE_EXTRASPACE
+	//new threads copy the main thread's extraspace
+	*(lua_ext_value**)lua_getextraspace(L) = (lua_ext_value*)lua_touserdata(L, -1);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);
+	*(lua_ext_value**)lua_getextraspace(lua_tothread(L, -1)) = (lua_ext_value*)lua_touserdata(L, -2);
+	lua_pop(L, 1);
+#endif
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_lua_ext_value_key); //pop
 }
 
 /*---------------------------------------------------------------------------*/
@@ -115,9 +201,10 @@ static void init_shared_ptr(lua_State *L)
 	lua_rawset(L, -3);
 
 	lua_pushstring(L, "__gc");
-	lua_pushcclosure(L, &detail::destroyer<detail::UserDataWapper>, 0);
+	lua_pushcclosure(L, &detail::userdata_destroyer, 0);
 	lua_rawset(L, -3);
 
+	detail::set_class_meta< std::shared_ptr<void> >(L);
 	lua_setglobal(L, S_SHARED_PTR_NAME); //pop table
 }
 
@@ -191,15 +278,18 @@ int create_class(lua_State*L)
 	lua_rawset(L, -3);
 
 	lua_pushstring(L, "__gc");
-	lua_pushcclosure(L, lua_tinker::detail::destroyer<lua_tinker::detail::UserDataWapper>, 0);
+	lua_pushcclosure(L, lua_tinker::detail::userdata_destroyer, 0);
 	lua_rawset(L, -3);
 
-	lua_pushstring(L, "__parent");
-	lua_tinker::detail::push_meta(L, szBaseClassName);
-	lua_rawset(L, -3);
+	lua_tinker::detail::meta_add_parent(L, lua_gettop(L), szBaseClassName);
 
 	{
-		lua_createtable(L, 0, 1);
+		lua_createtable(L, 0, 2);
+#ifdef LUATINKER_INHERIT_CACHE
+		lua_pushstring(L, "__newindex");
+		lua_pushcclosure(L, lua_tinker::detail::inherit_cache_newindex, 0);
+		lua_rawset(L, -3);
+#endif
 		{
 			lua_pushstring(L, "__call");
 			{
@@ -227,61 +317,267 @@ void lua_tinker::init(lua_State *L)
 }
 
 
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
+/*---------------------------------------------------------------------------*/
+/* inherit cast                                                              */
+/*---------------------------------------------------------------------------*/
+size_t lua_tinker::detail::alloc_type_idx()
+{
+	static std::atomic<size_t> s_next_type_idx(1);
+	return s_next_type_idx++;
+}
 
-bool find_inherit(size_t idThisType, size_t idTypeBase, lua_tinker::detail::InheritMap& refMap)
+/*---------------------------------------------------------------------------*/
+/* userdata destroy                                                          */
+/*---------------------------------------------------------------------------*/
+//type_idx -> destroy func, chunked so lookup never see a realloc
+static const size_t s_destroy_chunk_size = 256;
+static const size_t s_destroy_chunk_max = 4096;
+struct userdata_destroy_entry
 {
-	auto itFindPair = refMap.equal_range(idThisType);
-	if (itFindPair.first == refMap.end())
-		return false;
-	for (auto itFind = itFindPair.first; itFind != itFindPair.second; itFind++)
+	std::atomic<lua_tinker::detail::userdata_destroy_func_t> m_func[2];	//[bWeak]
+};
+static std::atomic<userdata_destroy_entry*> s_destroy_chunks[s_destroy_chunk_max];
+static std::mutex s_destroy_mutex;
+
+void lua_tinker::detail::_register_userdata_destroy(size_t nTypeIdx, bool bWeak, userdata_destroy_func_t func)
+{
+	size_t nChunk = nTypeIdx / s_destroy_chunk_size;
+	if (nChunk >= s_destroy_chunk_max)
 	{
-		if (itFind->second == idTypeBase)
-			return true;
-		if (find_inherit(itFind->second, idTypeBase, refMap) == true)
-			return true;
+		fprintf(stderr, "lua_tinker: too many userdata types\n");
+		return;
 	}
-	return false;
+	userdata_destroy_entry* pChunk = s_destroy_chunks[nChunk].load(std::memory_order_acquire);
+	if (pChunk == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(s_destroy_mutex);
+		pChunk = s_destroy_chunks[nChunk].load(std::memory_order_acquire);
+		if (pChunk == nullptr)
+		{
+			pChunk = new userdata_destroy_entry[s_destroy_chunk_size]();
+			s_destroy_chunks[nChunk].store(pChunk, std::memory_order_release);
+		}
+	}
+	pChunk[nTypeIdx % s_destroy_chunk_size].m_func[bWeak ? 1 : 0].store(func, std::memory_order_release);
+}
+
+int lua_tinker::detail::userdata_destroyer(lua_State *L)
+{
+	UserDataWapper* pWapper = (UserDataWapper*)lua_touserdata(L, 1);
+	//ptr and ref don't need destroy
+	if (pWapper == nullptr || (pWapper->m_flags & (UDF_OWNER | UDF_WEAK)) == 0)
+		return 0;
+	size_t nChunk = pWapper->m_type_idx / s_destroy_chunk_size;
+	if (nChunk >= s_destroy_chunk_max)
+		return 0;
+	userdata_destroy_entry* pChunk = s_destroy_chunks[nChunk].load(std::memory_order_acquire);
+	if (pChunk == nullptr)
+		return 0;
+	userdata_destroy_func_t func = pChunk[pWapper->m_type_idx % s_destroy_chunk_size].m_func[pWapper->is_weak() ? 1 : 0].load(std::memory_order_acquire);
+	if (func)
+		func(pWapper);
+	return 0;
 }
 
-bool lua_tinker::detail::IsInherit(lua_State* L, size_t idTypeDerived, size_t idTypeBase)
+//first do lhs, then rhs
+static lua_tinker::detail::cast_entry combine_cast(const lua_tinker::detail::cast_entry& lhs, const lua_tinker::detail::cast_entry& rhs)
 {
-	lua_stack_scope_exit scope_exit(L);
-	if (lua_getglobal(L, s_lua_ext_value_name) != LUA_TUSERDATA)
+	using lua_tinker::detail::cast_entry;
+	cast_entry entry;
+	entry.m_valid = true;
+	if (lhs.m_steps.empty() && rhs.m_steps.empty())
 	{
-		lua_pop(L,1); //pop getglobal
-		print_error(L, "can't find lua_ext_value");
-		return false;
+		entry.m_offset = lhs.m_offset + rhs.m_offset;
+		return entry;
 	}
+	for (const cast_entry* pEntry : { &lhs, &rhs })
+	{
+		if (pEntry->m_steps.empty())
+		{
+			if (pEntry->m_offset != 0)
+				entry.m_steps.push_back(cast_entry::cast_step{ pEntry->m_offset, nullptr });
+		}
+		else
+			entry.m_steps.insert(entry.m_steps.end(), pEntry->m_steps.begin(), pEntry->m_steps.end());
+	}
+	return entry;
+}
 
-	lua_ext_value* p_lua_ext_val = detail::user2type<lua_ext_value*>(L, -1);
-	auto& refMap = p_lua_ext_val->m_inherit_map;
+void lua_tinker::detail::inherit_cast_table::add(size_t idTypeDerived, size_t idTypeBase, const cast_entry& entry)
+{
+	if (idTypeDerived == idTypeBase)
+		return;
+	size_t nMaxIdx = std::max(idTypeDerived, idTypeBase);
+	if (m_table.size() <= nMaxIdx)
+		m_table.resize(nMaxIdx + 1);
+
+	//everything can convert to derived, can convert to every base of base now
+	cast_entry identity;
+	identity.m_valid = true;
+	std::vector<std::pair<size_t, cast_entry> > vecFrom{ { idTypeDerived, identity } };
+	for (size_t i = 0; i < m_table.size(); i++)
+	{
+		if (idTypeDerived < m_table[i].size() && m_table[i][idTypeDerived].m_valid)
+			vecFrom.emplace_back(i, m_table[i][idTypeDerived]);
+	}
+	std::vector<std::pair<size_t, cast_entry> > vecTo{ { idTypeBase, identity } };
+	const auto& refBaseRow = m_table[idTypeBase];
+	for (size_t i = 0; i < refBaseRow.size(); i++)
+	{
+		if (refBaseRow[i].m_valid)
+			vecTo.emplace_back(i, refBaseRow[i]);
+	}
 
-	
-	return find_inherit(idTypeDerived, idTypeBase, refMap);
-	
+	for (const auto& from : vecFrom)
+	{
+		for (const auto& to : vecTo)
+		{
+			if (from.first == to.first)
+				continue;
+			auto& refRow = m_table[from.first];
+			if (refRow.size() <= to.first)
+				refRow.resize(to.first + 1);
+			//first registered path win
+			if (refRow[to.first].m_valid)
+				continue;
+			refRow[to.first] = combine_cast(combine_cast(from.second, entry), to.second);
+		}
+	}
+}
 
-	
-	
+const char* lua_tinker::detail::get_type_name(lua_State* L, size_t type_idx)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr || type_idx >= p_lua_ext_val->m_type_names.size() || p_lua_ext_val->m_type_names[type_idx] == nullptr)
+		return "";
+	return p_lua_ext_val->m_type_names[type_idx];
+}
+
+void lua_tinker::detail::set_type_name(lua_State* L, size_t type_idx, const char* name)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr)
+		return;
+	if (type_idx >= p_lua_ext_val->m_type_names.size())
+		p_lua_ext_val->m_type_names.resize(type_idx + 1, nullptr);
+	const char*& refName = p_lua_ext_val->m_type_names[type_idx];
+	if (refName != nullptr && strcmp(refName, name) == 0)
+		return;
+	p_lua_ext_val->m_type_name_pool.emplace_back(name);
+	refName = p_lua_ext_val->m_type_name_pool.back().c_str();
+}
+
+const lua_tinker::detail::cast_entry* lua_tinker::detail::find_cast(lua_State* L, size_t idTypeDerived, size_t idTypeBase)
+{
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr)
+		return nullptr;
+	return p_lua_ext_val->m_inherit_cast.find(idTypeDerived, idTypeBase);
 }
 
-void lua_tinker::detail::_addInheritMap(lua_State* L, size_t idTypeDerived, size_t idTypeBase)
+void lua_tinker::detail::_add_cast(lua_State* L, size_t idTypeDerived, size_t idTypeBase, const cast_entry& entry)
 {
-	lua_stack_scope_exit scope_exit(L);
-	if (lua_getglobal(L, s_lua_ext_value_name) != LUA_TUSERDATA)
+	lua_ext_value* p_lua_ext_val = get_lua_ext_value(L);
+	if (p_lua_ext_val == nullptr)
+		return;
+	p_lua_ext_val->m_inherit_cast.add(idTypeDerived, idTypeBase, entry);
+}
+
+/*---------------------------------------------------------------------------*/
+/* borrowed userdata                                                         */
+/*---------------------------------------------------------------------------*/
+void lua_tinker::detail::_set_borrowed_metatable(lua_State* L)
+{
+	//lua only mark a userdata for finalization if its metatable has __gc when setmetatable
+	int nMetaIdx = lua_gettop(L);
+	if (lua_type(L, nMetaIdx) != LUA_TTABLE)
 	{
-		lua_pop(L,1); //pop getglobal
-		print_error(L, "can't find lua_ext_value");
+		lua_setmetatable(L, -2);
+		return;
+	}
+	lua_pushstring(L, "__gc");
+	lua_pushvalue(L, -1);
+	if (lua_rawget(L, nMetaIdx) == LUA_TNIL)
+	{
+		lua_pop(L, 2);
+		lua_setmetatable(L, -2);
 		return;
 	}
+	//obj, class_meta, "__gc", gc_func
+	lua_pushvalue(L, nMetaIdx + 1);
+	lua_pushnil(L);
+	lua_rawset(L, nMetaIdx);	//the key is still in the table, set it back won't alloc
+	lua_pushvalue(L, nMetaIdx);
+	lua_setmetatable(L, nMetaIdx - 1);
+	lua_rawset(L, nMetaIdx);	//class_meta.__gc = gc_func
+	lua_pop(L, 1);
+}
 
-	lua_ext_value* p_lua_ext_val = detail::user2type<lua_ext_value*>(L, -1);
-	auto& refMap = p_lua_ext_val->m_inherit_map;
-	refMap.emplace(idTypeDerived,idTypeBase);
+/*---------------------------------------------------------------------------*/
+/* identity cache                                                            */
+/*---------------------------------------------------------------------------*/
+void lua_tinker::detail::_identity_cache_enable(lua_State* L, const void* key, bool bEnable)
+{
+	if (bEnable == false)
+	{
+		lua_pushnil(L);
+		lua_rawsetp(L, LUA_REGISTRYINDEX, key);
+		return;
+	}
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, key) == LUA_TTABLE)
+	{
+		lua_pop(L, 1);
+		return;
+	}
+	lua_pop(L, 1);
+	lua_createtable(L, 0, 64);
+	lua_createtable(L, 0, 1);
+	lua_pushstring(L, "__mode");
+	lua_pushstring(L, "v");
+	lua_rawset(L, -3);
+	lua_setmetatable(L, -2);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, key);
 }
 
+lua_tinker::detail::UserDataWapper* lua_tinker::detail::_identity_cache_push(lua_State* L, const void* key, const void* ptr)
+{
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, key) != LUA_TTABLE)
+	{
+		lua_pop(L, 1);
+		return nullptr;
+	}
+	if (lua_rawgetp(L, -1, ptr) != LUA_TUSERDATA)
+	{
+		lua_pop(L, 2);
+		return nullptr;
+	}
+	lua_remove(L, -2);
+	return (UserDataWapper*)lua_touserdata(L, -1);
+}
 
-#endif
+void lua_tinker::detail::_identity_cache_store(lua_State* L, const void* key, const void* ptr)
+{
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, key) != LUA_TTABLE)
+	{
+		lua_pop(L, 1);
+		return;
+	}
+	lua_pushvalue(L, -2);
+	lua_rawsetp(L, -2, ptr);
+	lua_pop(L, 1);
+}
+
+void lua_tinker::detail::_identity_cache_forget(lua_State* L, const void* key, const void* ptr)
+{
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, key) != LUA_TTABLE)
+	{
+		lua_pop(L, 1);
+		return;
+	}
+	lua_pushnil(L);
+	lua_rawsetp(L, -2, ptr);
+	lua_pop(L, 1);
+}
 
 /*---------------------------------------------------------------------------*/
 /* debug helpers                                                             */
@@ -460,12 +756,34 @@ void lua_tinker::detail::_stack_help<lua_tinker::table_onstack>::_push(lua_State
 	lua_pushvalue(L, ret.m_obj->m_index);
 }
 
+lua_tinker::stack_table lua_tinker::detail::_stack_help<lua_tinker::stack_table>::_read(lua_State *L, int index)
+{
+	return lua_tinker::stack_table(L, index);
+}
+
+void lua_tinker::detail::_stack_help<lua_tinker::stack_table>::_push(lua_State *L, const lua_tinker::stack_table& ret)
+{
+	lua_pushvalue(L, ret.m_index);
+}
+
 
 std::string lua_tinker::detail::_stack_help<std::string>::_read(lua_State *L, int index)
 {
-	const char* strLua = lua_tostring(L,index);
-	if(strLua)
-		return std::string(strLua);
+	size_t nLen = 0;
+	if (lua_type(L, index) == LUA_TSTRING)
+	{
+		const char* strLua = lua_tolstring(L, index, &nLen);
+		return std::string(strLua, nLen);
+	}
+	else if (lua_type(L, index) == LUA_TNUMBER)
+	{
+		//convert a copy, lua_tolstring will change the number in place (a key of lua_next)
+		lua_pushvalue(L, index);
+		const char* strLua = lua_tolstring(L, -1, &nLen);
+		std::string str(strLua, nLen);
+		lua_pop(L, 1);
+		return str;
+	}
 	else
 		return std::string();
 }
@@ -475,6 +793,21 @@ void lua_tinker::detail::_stack_help<std::string>::_push(lua_State *L, const std
 	lua_pushlstring(L, ret.data(), ret.size());
 }
 
+lua_tinker::string_view lua_tinker::detail::_stack_help<lua_tinker::string_view>::_read(lua_State *L, int index)
+{
+	size_t nLen = 0;
+	const char* strLua = lua_tolstring(L, index, &nLen);
+	if (strLua)
+		return string_view(strLua, nLen);
+	else
+		return string_view();
+}
+
+void lua_tinker::detail::_stack_help<lua_tinker::string_view>::_push(lua_State *L, const string_view& ret)
+{
+	lua_pushlstring(L, ret.data(), ret.size());
+}
+
 
 /*---------------------------------------------------------------------------*/
 /* pop                                                                       */
@@ -499,6 +832,11 @@ lua_tinker::table_onstack lua_tinker::detail::pop<lua_tinker::table_onstack>::ap
 	return table_onstack(L, lua_gettop(L));
 }
 
+lua_tinker::stack_table lua_tinker::detail::pop<lua_tinker::stack_table>::apply(lua_State *L)
+{
+	return stack_table(L, lua_gettop(L));
+}
+
 
 /*---------------------------------------------------------------------------*/
 /* Tinker Class Helper                                                       */
@@ -511,7 +849,7 @@ static void invoke_parent(lua_State *L)
 
 	stack_obj index_key(L, 2);
 	stack_obj class_meta = stack_obj::get_top(L);
-	stack_obj parent_table= class_meta.rawget("__parent");
+	stack_obj parent_table= class_meta.rawgetp(&s_parent_key);
 	if (parent_table.is_nil())
 	{
 		return;
@@ -545,7 +883,7 @@ static void invoke_parent(lua_State *L)
 	//try multi_parent
 	{
 		parent_table.remove();
-		stack_obj parent_table = class_meta.rawget("__multi_parent");
+		stack_obj parent_table = class_meta.rawgetp(&s_multi_parent_key);
 		if (parent_table.is_table())
 		{
 			table_iterator it(parent_table);
@@ -591,9 +929,388 @@ static void invoke_parent(lua_State *L)
 
 
 
+#ifdef LUATINKER_INHERIT_CACHE
+//registry[&s_inherit_cache_key] = { [class_meta] = true }, all metatables which have cached members
+static const char s_inherit_cache_key = 0;
+static const char* s_inherit_cached_name = "__inherit_cached";
+
+//class_meta[key] = top, and remember key and val in class_meta.__inherit_cached
+static void inherit_cache_add(lua_State *L, int nMetaIdx, int nKeyIdx)
+{
+	using namespace lua_tinker::detail;
+	stack_scope_exit scope_exit(L);
+	stack_obj class_meta(L, nMetaIdx);
+	stack_obj key_obj(L, nKeyIdx);
+	stack_obj val_obj = stack_obj::get_top(L);
+	if (lua_type(L, key_obj._stack_pos) != LUA_TSTRING)
+		return;
+
+	stack_obj cached_keys = class_meta.rawget(s_inherit_cached_name);
+	if (cached_keys.is_table() == false)
+	{
+		cached_keys.remove();
+		cached_keys = stack_obj::new_table(L, 0, 4);
+		lua_pushstring(L, s_inherit_cached_name);
+		cached_keys.push_top();
+		class_meta.rawset();// set class_meta.__inherit_cached = {}
+
+		if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_inherit_cache_key) != LUA_TTABLE)
+		{
+			lua_pop(L, 1);
+			lua_createtable(L, 0, 8);
+			lua_pushvalue(L, -1);
+			lua_rawsetp(L, LUA_REGISTRYINDEX, &s_inherit_cache_key);
+		}
+		class_meta.push_top();
+		lua_pushboolean(L, 1);
+		lua_rawset(L, -3);	// registry[&s_inherit_cache_key][class_meta] = true
+		lua_pop(L, 1);
+	}
+
+	key_obj.push_top();
+	val_obj.push_top();
+	cached_keys.rawset();	// __inherit_cached[key] = val
+
+	key_obj.push_top();
+	val_obj.push_top();
+	class_meta.rawset();	// class_meta[key] = val
+}
+
+void lua_tinker::detail::inherit_cache_flush(lua_State *L)
+{
+	stack_scope_exit scope_exit(L);
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_inherit_cache_key) != LUA_TTABLE)
+		return;
+
+	stack_obj cache_set = stack_obj::get_top(L);
+	table_iterator it(cache_set);
+	while (it.hasNext())
+	{
+		stack_obj class_meta = it.key();
+		stack_obj cached_keys = class_meta.rawget(s_inherit_cached_name);
+		if (cached_keys.is_table())
+		{
+			table_iterator it_key(cached_keys);
+			while (it_key.hasNext())
+			{
+				//lua may have overridden the cached member with a raw write, keep it
+				lua_pushvalue(L, it_key.key_idx());
+				lua_rawget(L, class_meta._stack_pos);
+				bool bCached = lua_rawequal(L, -1, it_key.value_idx()) != 0;
+				lua_pop(L, 1);
+				if (bCached)
+				{
+					lua_pushvalue(L, it_key.key_idx());
+					lua_pushnil(L);
+					class_meta.rawset();	// class_meta[key] = nil
+				}
+				it_key.moveNext();
+			}
+		}
+		cached_keys.remove();
+
+		lua_pushstring(L, s_inherit_cached_name);
+		lua_pushnil(L);
+		class_meta.rawset();	// class_meta.__inherit_cached = nil
+		it.moveNext();
+	}
+
+	lua_pushnil(L);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_inherit_cache_key);
+}
+
+int lua_tinker::detail::inherit_cache_newindex(lua_State *L)
+{
+	inherit_cache_flush(L);
+	lua_rawset(L, 1);
+	return 0;
+}
+#endif
+
+//class_meta.__field_table, sorted by key ptr
+//short lua strings are interned, the same name always have the same ptr while it's alive
+struct field_table
+{
+	struct field_entry
+	{
+		const char* m_key;
+		lua_tinker::detail::var_base* m_var;
+		lua_tinker::detail::field_thunk_t m_get;
+		lua_tinker::detail::field_thunk_t m_set;
+		bool operator<(const char* key) const { return m_key < key; }
+	};
+	std::vector<field_entry> m_fields;
+
+	const field_entry* find(const char* key) const
+	{
+		auto it = std::lower_bound(m_fields.begin(), m_fields.end(), key);
+		if (it != m_fields.end() && it->m_key == key)
+			return &(*it);
+		return nullptr;
+	}
+};
+static const char* s_field_table_name = "__field_table";
+
+//push a meta_get/meta_set closure, upvalue(1) is class_meta.__field_table or nil, upvalue(2) is the native index checked flag
+static void push_meta_accessor(lua_State *L, int nMetaIdx, lua_CFunction func, bool bChecked)
+{
+	nMetaIdx = lua_absindex(L, nMetaIdx);
+	lua_pushstring(L, s_field_table_name);
+	if (lua_rawget(L, nMetaIdx) != LUA_TUSERDATA && bChecked == false)
+	{
+		lua_pop(L, 1);
+		lua_pushcclosure(L, func, 0);
+		return;
+	}
+	lua_pushboolean(L, bChecked);
+	lua_pushcclosure(L, func, 2);
+}
+
+void lua_tinker::detail::field_table_add(lua_State *L, int nMetaIdx, int nKeyIdx, var_base* pVar, field_thunk_t get_thunk, field_thunk_t set_thunk)
+{
+	stack_scope_exit scope_exit(L);
+	nMetaIdx = lua_absindex(L, nMetaIdx);
+	nKeyIdx = lua_absindex(L, nKeyIdx);
+	lua_pushstring(L, s_field_table_name);
+	if (lua_rawget(L, nMetaIdx) != LUA_TUSERDATA)
+	{
+		lua_pop(L, 1);
+		new(lua_newuserdata(L, sizeof(field_table))) field_table;
+		lua_createtable(L, 0, 1);
+		lua_pushstring(L, "__gc");
+		lua_pushcclosure(L, &destroyer<field_table>, 0);
+		lua_rawset(L, -3);
+		lua_setmetatable(L, -2);
+		//uservalue hold all keys, so the key ptr will not be reused by other string
+		lua_createtable(L, 0, 4);
+		lua_setuservalue(L, -2);
+
+		lua_pushstring(L, s_field_table_name);
+		lua_pushvalue(L, -2);
+		lua_rawset(L, nMetaIdx);	//class_meta.__field_table = field_table
+
+		lua_pushstring(L, "__index");
+		push_meta_accessor(L, nMetaIdx, meta_get, false);
+		lua_rawset(L, nMetaIdx);
+		lua_pushstring(L, "__newindex");
+		push_meta_accessor(L, nMetaIdx, meta_set, false);
+		lua_rawset(L, nMetaIdx);
+	}
+	field_table* pTable = (field_table*)lua_touserdata(L, -1);
+	lua_getuservalue(L, -1);
+	lua_pushvalue(L, nKeyIdx);
+	lua_pushboolean(L, 1);
+	lua_rawset(L, -3);
+
+	const char* key = lua_tostring(L, nKeyIdx);
+	auto it = std::lower_bound(pTable->m_fields.begin(), pTable->m_fields.end(), key);
+	if (it != pTable->m_fields.end() && it->m_key == key)
+		*it = field_table::field_entry{ key, pVar, get_thunk, set_thunk };
+	else
+		pTable->m_fields.insert(it, field_table::field_entry{ key, pVar, get_thunk, set_thunk });
+}
+
+#ifdef LUATINKER_NATIVE_METHOD_INDEX
+//registry[&s_native_index_key] = { [class_meta] = NIS_XXX }
+static const char s_native_index_key = 0;
+enum NATIVE_INDEX_STATE
+{
+	NIS_DISABLE = 0,	//checked, have var_base, keep meta_get
+	NIS_ENABLE	= 1,	//checked, class_meta.__index = class_meta
+	NIS_LINKED	= 2,	//only link metatable.__index to parents
+};
+
+//class_meta and all parents have no var_base
+static bool native_index_check(lua_State *L, int nMetaIdx, int nDepth)
+{
+	using namespace lua_tinker::detail;
+	if (nDepth > 64)
+		return false;
+	stack_scope_exit scope_exit(L);
+	stack_obj class_meta(L, nMetaIdx);
+	table_iterator it(class_meta);
+	while (it.hasNext())
+	{
+		if (it.value().is_userdata())
+			return false;
+		it.moveNext();
+	}
+
+	stack_obj parent_table = class_meta.rawgetp(&s_parent_key);
+	if (parent_table.is_table() && native_index_check(L, parent_table._stack_pos, nDepth + 1) == false)
+		return false;
+	stack_obj multi_parent = class_meta.rawgetp(&s_multi_parent_key);
+	if (multi_parent.is_table())
+	{
+		int nLen = multi_parent.get_rawlen();
+		for (int i = 1; i <= nLen; i++)
+		{
+			stack_obj base_table = multi_parent.rawgeti(i);
+			if (base_table.is_table() && native_index_check(L, base_table._stack_pos, nDepth + 1) == false)
+				return false;
+			base_table.remove();
+		}
+	}
+	return true;
+}
+
+//class_meta's metatable.__index for multi inheritance, (class_meta, key)
+static int native_index_multi_parent(lua_State *L)
+{
+	lua_settop(L, 2);
+	if (lua_rawgetp(L, 1, &s_parent_key) == LUA_TTABLE)
+	{
+		lua_pushvalue(L, 2);
+		if (lua_gettable(L, -2) != LUA_TNIL)	//follow parent's metatable
+			return 1;
+	}
+	lua_settop(L, 2);
+	if (lua_rawgetp(L, 1, &s_multi_parent_key) == LUA_TTABLE)
+	{
+		int nLen = (int)lua_rawlen(L, 3);
+		for (int i = 1; i <= nLen; i++)
+		{
+			if (lua_rawgeti(L, 3, i) == LUA_TTABLE)
+			{
+				lua_pushvalue(L, 2);
+				if (lua_gettable(L, -2) != LUA_TNIL)
+					return 1;
+			}
+			lua_settop(L, 3);
+		}
+	}
+	lua_pushnil(L);
+	return 1;
+}
+
+//set class_meta's metatable.__index to parents, do it for all parents too
+static void native_index_link(lua_State *L, int nMetaIdx, int nSetIdx, int nDepth)
+{
+	using namespace lua_tinker::detail;
+	if (nDepth > 64)
+		return;
+	stack_scope_exit scope_exit(L);
+	stack_obj class_meta(L, nMetaIdx);
+	stack_obj state_set(L, nSetIdx);
+	class_meta.push_top();
+	if (lua_rawget(L, nSetIdx) == LUA_TNIL)
+	{
+		class_meta.push_top();
+		lua_pushinteger(L, NIS_LINKED);
+		state_set.rawset();
+	}
+
+	stack_obj parent_table = class_meta.rawgetp(&s_parent_key);
+	if (parent_table.is_table() == false)
+		return;
+	stack_obj multi_parent = class_meta.rawgetp(&s_multi_parent_key);
+
+	if (lua_getmetatable(L, class_meta._stack_pos) == 0)
+	{
+		lua_createtable(L, 0, 1);
+		lua_pushvalue(L, -1);
+		lua_setmetatable(L, class_meta._stack_pos);
+	}
+	stack_obj meta_meta = stack_obj::get_top(L);
+	lua_pushstring(L, "__index");
+	if (multi_parent.is_table())
+		lua_pushcclosure(L, native_index_multi_parent, 0);
+	else
+		parent_table.push_top();
+	meta_meta.rawset();	// getmetatable(class_meta).__index = __parent
+
+	native_index_link(L, parent_table._stack_pos, nSetIdx, nDepth + 1);
+	if (multi_parent.is_table())
+	{
+		int nLen = multi_parent.get_rawlen();
+		for (int i = 1; i <= nLen; i++)
+		{
+			stack_obj base_table = multi_parent.rawgeti(i);
+			if (base_table.is_table())
+				native_index_link(L, base_table._stack_pos, nSetIdx, nDepth + 1);
+			base_table.remove();
+		}
+	}
+}
+
+//first visit by meta_get, check whether the class can use itself as __index
+static void native_index_try(lua_State *L, int nMetaIdx)
+{
+	using namespace lua_tinker::detail;
+	stack_scope_exit scope_exit(L);
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_native_index_key) != LUA_TTABLE)
+	{
+		lua_pop(L, 1);
+		lua_createtable(L, 0, 8);
+		lua_pushvalue(L, -1);
+		lua_rawsetp(L, LUA_REGISTRYINDEX, &s_native_index_key);
+	}
+	stack_obj state_set = stack_obj::get_top(L);
+	stack_obj class_meta(L, nMetaIdx);
+	bool bEnable = native_index_check(L, class_meta._stack_pos, 0);
+	class_meta.push_top();
+	lua_pushinteger(L, bEnable ? NIS_ENABLE : NIS_DISABLE);
+	state_set.rawset();
+	if (bEnable == false)
+	{
+		//meta_get with upvalue(2) true means checked, don't try again
+		lua_pushstring(L, "__index");
+		push_meta_accessor(L, class_meta._stack_pos, meta_get, true);
+		class_meta.rawset();
+		return;
+	}
+
+	native_index_link(L, class_meta._stack_pos, state_set._stack_pos, 0);
+	lua_pushstring(L, "__index");
+	class_meta.push_top();
+	class_meta.rawset();	// class_meta.__index = class_meta
+}
+
+void lua_tinker::detail::native_index_reset(lua_State *L)
+{
+	stack_scope_exit scope_exit(L);
+	if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_native_index_key) != LUA_TTABLE)
+		return;
+
+	stack_obj state_set = stack_obj::get_top(L);
+	table_iterator it(state_set);
+	while (it.hasNext())
+	{
+		stack_obj class_meta = it.key();
+		if (lua_tointeger(L, it.value()._stack_pos) != NIS_LINKED)
+		{
+			lua_pushstring(L, "__index");
+			push_meta_accessor(L, class_meta._stack_pos, meta_get, false);
+			class_meta.rawset();
+		}
+		if (lua_getmetatable(L, class_meta._stack_pos))
+		{
+			lua_pushstring(L, "__index");
+			lua_pushnil(L);
+			lua_rawset(L, -3);
+			lua_pop(L, 1);
+		}
+		it.moveNext();
+	}
+
+	lua_pushnil(L);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &s_native_index_key);
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 int lua_tinker::detail::meta_get(lua_State *L)
 {
+	if (lua_type(L, lua_upvalueindex(1)) == LUA_TUSERDATA && lua_type(L, 2) == LUA_TSTRING)
+	{
+		const field_table* pTable = (const field_table*)lua_touserdata(L, lua_upvalueindex(1));
+		const field_table::field_entry* pEntry = pTable->find(lua_tostring(L, 2));
+		if (pEntry != nullptr)
+		{
+			pEntry->m_get(L, pEntry->m_var);	//push a val
+			return 1;
+		}
+	}
 	stack_obj class_obj(L, 1);
 	stack_obj key_obj(L, 2);
 	stack_obj class_meta = class_obj.get_metatable();
@@ -608,6 +1325,10 @@ int lua_tinker::detail::meta_get(lua_State *L)
 		val_obj.remove();
 		invoke_parent(L);
 		val_obj = stack_obj::get_top(L);
+#ifdef LUATINKER_INHERIT_CACHE
+		if (val_obj.is_nil() == false)
+			inherit_cache_add(L, class_meta._stack_pos, key_obj._stack_pos);
+#endif
 		if (val_obj.is_userdata())
 		{
 			detail::user2type<detail::var_base*>(L, val_obj._stack_pos)->get(L); //push a val
@@ -619,6 +1340,10 @@ int lua_tinker::detail::meta_get(lua_State *L)
 			lua_error(L);
 		}
 	}
+#ifdef LUATINKER_NATIVE_METHOD_INDEX
+	if (lua_toboolean(L, lua_upvalueindex(2)) == 0)
+		native_index_try(L, class_meta._stack_pos);
+#endif
 	class_meta.remove();
 	return 1;
 }
@@ -626,6 +1351,16 @@ int lua_tinker::detail::meta_get(lua_State *L)
 /*---------------------------------------------------------------------------*/
 int lua_tinker::detail::meta_set(lua_State *L)
 {
+	if (lua_type(L, lua_upvalueindex(1)) == LUA_TUSERDATA && lua_type(L, 2) == LUA_TSTRING)
+	{
+		const field_table* pTable = (const field_table*)lua_touserdata(L, lua_upvalueindex(1));
+		const field_table::field_entry* pEntry = pTable->find(lua_tostring(L, 2));
+		if (pEntry != nullptr)
+		{
+			pEntry->m_set(L, pEntry->m_var);
+			return 0;
+		}
+	}
 	stack_scope_exit scope_exit(L);
 	stack_obj class_obj(L, 1);
 	stack_obj key_obj(L, 2);
@@ -644,6 +1379,10 @@ int lua_tinker::detail::meta_set(lua_State *L)
 		class_meta.push_top();
 		invoke_parent(L);
 		val_obj = stack_obj::get_top(L);
+#ifdef LUATINKER_INHERIT_CACHE
+		if (val_obj.is_nil() == false)
+			inherit_cache_add(L, class_meta._stack_pos, key_obj._stack_pos);
+#endif
 		if (val_obj.is_userdata())
 		{
 			detail::user2type<detail::var_base*>(L, val_obj._stack_pos)->set(L);
@@ -664,9 +1403,52 @@ int lua_tinker::detail::push_meta(lua_State *L, const char* name)
 	return lua_getglobal(L, name);
 }
 
+void lua_tinker::detail::meta_add_parent(lua_State *L, int nMetaIdx, const char* parent_name)
+{
+	stack_scope_exit scope_exit(L);
+	nMetaIdx = lua_absindex(L, nMetaIdx);
+#ifdef LUATINKER_MULTI_INHERITANCE
+	if (lua_rawgetp(L, nMetaIdx, &s_parent_key) != LUA_TNIL)
+	{
+		if (lua_rawgetp(L, nMetaIdx, &s_multi_parent_key) != LUA_TTABLE)
+		{
+			lua_pop(L, 1);
+			lua_createtable(L, 1, 0);
+			lua_pushvalue(L, -1);
+			lua_rawsetp(L, nMetaIdx, &s_multi_parent_key);
+			lua_pushstring(L, "__multi_parent");
+			lua_pushvalue(L, -2);
+			lua_rawset(L, nMetaIdx);	// class_meta["__multi_parent"] = __multi_parent
+		}
+		int nLen = (int)lua_rawlen(L, -1) + 1;
+		push_meta(L, parent_name);
+		lua_rawseti(L, -2, nLen);	// __multi_parent[n] = table
+		return;
+	}
+	lua_pop(L, 1);
+#endif
+	push_meta(L, parent_name);
+	lua_pushvalue(L, -1);
+	lua_rawsetp(L, nMetaIdx, &s_parent_key);
+	lua_pushstring(L, "__parent");
+	lua_insert(L, -2);
+	lua_rawset(L, nMetaIdx);	// class_meta["__parent"] = __parent
+}
+
 void lua_tinker::detail::push_args(lua_State *L)
 {}
 
+bool lua_tinker::detail::is_wapper_userdata(lua_State* L, int nIndex)
+{
+	if (lua_type(L, nIndex) != LUA_TUSERDATA || lua_getmetatable(L, nIndex) == 0)
+		return false;
+	lua_pushstring(L, "__gc");
+	lua_rawget(L, -2);
+	bool bResult = lua_tocfunction(L, -1) == &userdata_destroyer;
+	lua_pop(L, 2);
+	return bResult;
+}
+
 bool lua_tinker::detail::CheckSameMetaTable(lua_State* L, int nIndex, const char* tname)
 {
 	bool bResult = true;
@@ -822,6 +1604,15 @@ lua_tinker::table_onstack::table_onstack(lua_State* L)
 	m_obj->inc_ref();
 }
 
+lua_tinker::table_onstack::table_onstack(lua_State* L, int narr, int nrec)
+{
+	lua_createtable(L, narr, nrec);
+
+	m_obj = new detail::table_obj(L, lua_gettop(L));
+
+	m_obj->inc_ref();
+}
+
 lua_tinker::table_onstack::table_onstack(lua_State* L, const char* name)
 {
 	if (lua_getglobal(L, name) != LUA_TTABLE)
@@ -873,15 +1664,21 @@ namespace lua_tinker
 		lua_ref_base::lua_ref_base(lua_State* L, int regidx)
 			:m_L(L)
 			, m_regidx(regidx)
-			, m_pRef(new int(0))
 		{
+			lua_ext_value* p_lua_ext_val = (regidx >= 0) ? get_lua_ext_value(L) : nullptr;
+			if (p_lua_ext_val != nullptr)
+			{
+				m_pRefCount = &p_lua_ext_val->m_ref_count;
+				if ((size_t)regidx >= m_pRefCount->size())
+					m_pRefCount->resize(regidx + 1, 0);
+			}
 			inc_ref();
 		}
 
 		lua_ref_base::lua_ref_base(const lua_ref_base& rht)
 			:m_L(rht.m_L)
 			, m_regidx(rht.m_regidx)
-			, m_pRef(rht.m_pRef)
+			, m_pRefCount(rht.m_pRefCount)
 		{
 			inc_ref();
 		}
@@ -889,9 +1686,11 @@ namespace lua_tinker
 		lua_ref_base::lua_ref_base(lua_ref_base&& rht)
 			:m_L(rht.m_L)
 			, m_regidx(rht.m_regidx)
-			, m_pRef(rht.m_pRef)
+			, m_pRefCount(rht.m_pRefCount)
 		{
-			rht.m_pRef = nullptr;
+			rht.m_L = nullptr;
+			rht.m_regidx = LUA_NOREF;
+			rht.m_pRefCount = nullptr;
 		}
 
 		lua_ref_base& lua_ref_base::operator=(const lua_ref_base& rht)
@@ -901,7 +1700,7 @@ namespace lua_tinker
 				dec_ref();
 				m_L = rht.m_L;
 				m_regidx = rht.m_regidx;
-				m_pRef = rht.m_pRef;
+				m_pRefCount = rht.m_pRefCount;
 				inc_ref();
 			}
 			return *this;
@@ -916,30 +1715,177 @@ namespace lua_tinker
 		void lua_ref_base::destory()
 		{
 			luaL_unref(m_L, LUA_REGISTRYINDEX, m_regidx);
-			delete m_pRef;
 		}
 
 		void lua_ref_base::reset()
 		{
 			dec_ref();
 			m_L = nullptr;
-			m_regidx = -1;
-			m_pRef = nullptr;
+			m_regidx = LUA_NOREF;
+			m_pRefCount = nullptr;
 		}
 
 		void lua_ref_base::inc_ref()
 		{
-			if (m_pRef)
-				++(*m_pRef);
+			if (m_pRefCount)
+				++(*m_pRefCount)[m_regidx];
 		}
 
 		void lua_ref_base::dec_ref()
 		{
-			if (m_pRef)
+			if (m_pRefCount)
 			{
-				if (--(*m_pRef) == 0)
+				if (--(*m_pRefCount)[m_regidx] == 0)
 					destory();
 			}
 		}
+
+		lua_unique_ref_base::lua_unique_ref_base(lua_State* L, int regidx)
+			:m_L(L)
+			, m_regidx(regidx)
+		{
+		}
+
+		lua_unique_ref_base::~lua_unique_ref_base()
+		{
+			reset();
+		}
+
+		lua_unique_ref_base::lua_unique_ref_base(lua_unique_ref_base&& rht)
+			:m_L(rht.m_L)
+			, m_regidx(rht.m_regidx)
+		{
+			rht.m_L = nullptr;
+			rht.m_regidx = LUA_NOREF;
+		}
+
+		lua_unique_ref_base& lua_unique_ref_base::operator=(lua_unique_ref_base&& rht)
+		{
+			if (this != &rht)
+			{
+				reset();
+				m_L = rht.m_L;
+				m_regidx = rht.m_regidx;
+				rht.m_L = nullptr;
+				rht.m_regidx = LUA_NOREF;
+			}
+			return *this;
+		}
+
+		void lua_unique_ref_base::reset()
+		{
+			if (m_L != nullptr)
+				luaL_unref(m_L, LUA_REGISTRYINDEX, m_regidx);
+			m_L = nullptr;
+			m_regidx = LUA_NOREF;
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* key                                                                       */
+/*---------------------------------------------------------------------------*/
+static int intern_string_ref(lua_State* L, const char* str, size_t len)
+{
+	lua_pushlstring(L, str, len);
+	return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+lua_tinker::key::key(lua_State* L, const char* str)
+	:lua_ref_base(L, intern_string_ref(L, str, strlen(str)))
+{
+}
+
+lua_tinker::key::key(lua_State* L, const char* str, size_t len)
+	:lua_ref_base(L, intern_string_ref(L, str, len))
+{
+}
+
+void lua_tinker::detail::push(lua_State *L, const key& ret)
+{
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ret.m_regidx);
+}
+
+void lua_tinker::detail::_stack_help<lua_tinker::key>::_push(lua_State *L, const key& ret)
+{
+	lua_rawgeti(L, LUA_REGISTRYINDEX, ret.m_regidx);
+}
+
+/*---------------------------------------------------------------------------*/
+/* call batch                                                                */
+/*---------------------------------------------------------------------------*/
+int lua_tinker::detail::_call_batch_error_handler(lua_State* L)
+{
+	const char* pMsg = lua_tostring(L, 1);
+	luaL_traceback(L, L, pMsg != nullptr ? pMsg : "(error object is not a string)", 1);
+	return 1;
+}
+
+/*---------------------------------------------------------------------------*/
+/* call handle                                                               */
+/*---------------------------------------------------------------------------*/
+lua_tinker::detail::call_handle_base::call_handle_base(lua_State* L, const char* name)
+{
+	bind(L, name);
+}
+
+lua_tinker::detail::call_handle_base::~call_handle_base()
+{
+	release();
+}
+
+lua_tinker::detail::call_handle_base::call_handle_base(call_handle_base&& rht)
+	:m_L(rht.m_L)
+	, m_regidx(rht.m_regidx)
+	, m_name(std::move(rht.m_name))
+{
+	rht.m_L = nullptr;
+	rht.m_regidx = LUA_NOREF;
+}
+
+lua_tinker::detail::call_handle_base& lua_tinker::detail::call_handle_base::operator=(call_handle_base&& rht)
+{
+	if (this != &rht)
+	{
+		release();
+		m_L = rht.m_L;
+		m_regidx = rht.m_regidx;
+		m_name = std::move(rht.m_name);
+		rht.m_L = nullptr;
+		rht.m_regidx = LUA_NOREF;
+	}
+	return *this;
+}
+
+bool lua_tinker::detail::call_handle_base::bind(lua_State* L, const char* name)
+{
+	release();
+	m_L = L;
+	m_name = name;
+	return rebind();
+}
+
+bool lua_tinker::detail::call_handle_base::rebind()
+{
+	if (m_L == nullptr)
+		return false;
+	if (lua_getglobal(m_L, m_name.c_str()) != LUA_TFUNCTION)
+	{
+		lua_pop(m_L, 1);
+		lua_tinker::print_error(m_L, "lua_tinker::call_handle attempt to bind global `%s' (not a function)", m_name.c_str());
+		return false;
 	}
+	if (m_regidx == LUA_NOREF)
+		m_regidx = luaL_ref(m_L, LUA_REGISTRYINDEX);
+	else
+		lua_rawseti(m_L, LUA_REGISTRYINDEX, m_regidx);	//reuse the slot
+	return true;
+}
+
+void lua_tinker::detail::call_handle_base::release()
+{
+	if (m_L != nullptr && m_regidx != LUA_NOREF)
+		luaL_unref(m_L, LUA_REGISTRYINDEX, m_regidx);
+	m_L = nullptr;
+	m_regidx = LUA_NOREF;
 }
@@ -12,6 +12,7 @@
 #include <new>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <typeinfo>
 #include <type_traits>
@@ -21,6 +22,13 @@
 #include<set>
 #include<map>
 #include<vector>
+#include<array>
+#include<algorithm>
+#include<atomic>
+#include<iterator>
+#if __cplusplus >= 201703L
+#include<string_view>
+#endif
 
 #include"lua.hpp"
 #include"type_traits_ext.h" 
@@ -41,16 +49,33 @@
 #define LUA_CHECK_HAVE_THIS_PARAM_AND_NOT_NIL(L,index)
 #endif
 
-#define CHECK_CLASS_PTR(T) {if(lua_isnoneornil(L,1)){lua_pushfstring(L, "class_ptr %s is nil or none", lua_tinker::detail::get_class_name<T>());lua_error(L);} }
+#define CHECK_CLASS_PTR(T) {if(lua_isnoneornil(L,1)){lua_pushfstring(L, "class_ptr %s is nil or none", lua_tinker::detail::get_class_name<T>(L));lua_error(L);} }
+
+//compile-time bound function for def/class_def, lua_tinker::def<LUATINKER_BIND(&func)>(L, "func")
+#define LUATINKER_BIND(func) decltype(func), func
 
 #define TRY_LUA_TINKER_INVOKE() try
 #define CATCH_LUA_TINKER_INVOKE() catch(...)
 
 #define LUATINKER_MULTI_INHERITANCE
 
+//define LUATINKER_INHERIT_CACHE, a member found in __parent/__multi_parent will be copied to the derived metatable at first visit,
+//next visit only need one rawget. the cache is flushed when class_def/class_mem/class_inh... or lua add a new member to a class
+//#define LUATINKER_INHERIT_CACHE
+
+//define LUATINKER_NATIVE_METHOD_INDEX, a class which and whose parents have no class_mem/class_property will use its metatable as __index
+//after the first visit, so lua vm find the method without call meta_get; class_meta's metatable.__index will link to __parent.
+//visit a not exist member of these classes return nil instead of error. any class_xxx register will switch back to meta_get
+//#define LUATINKER_NATIVE_METHOD_INDEX
+
+//define LUATINKER_USE_EXTRASPACE, lua_tinker's per state context is kept in lua_getextraspace(L) instead of a registry slot,
+//the app must not use LUA_EXTRASPACE itself. lua copy the main thread's extraspace to a new thread, so create coroutines after init,
+//a thread created before init is not supported (_DEBUG build report it, release build read garbage)
+//#define LUATINKER_USE_EXTRASPACE
+
 namespace lua_tinker
 {
-	extern const char* S_SHARED_PTR_NAME;
+	extern const char* const S_SHARED_PTR_NAME;
 
 	// init LuaTinker
 	void    init(lua_State *L);
@@ -59,10 +84,20 @@ namespace lua_tinker
 	typedef std::function<void(lua_State*)> Lua_Close_CallBack_Func;
 	void	register_lua_close_callback(lua_State* L, Lua_Close_CallBack_Func&& callback_func);
 
-	//error callback
+	//error callback, the global one is used by every state which has not set its own
 	typedef int(*error_call_back_fn)(lua_State *L);
 	error_call_back_fn get_error_callback();
 	void set_error_callback(error_call_back_fn fn);
+	//per state error callback, nullptr to use the global one again
+	error_call_back_fn get_error_callback(lua_State* L);
+	void set_error_callback(lua_State* L, error_call_back_fn fn);
+
+	//per state statistics
+	struct state_stats
+	{
+		size_t m_nCallError = 0;	//failed lua_pcall of dofile/dostring/call/lua_function_ref/call_handle, failed item of call_batch
+	};
+	const state_stats* get_state_stats(lua_State* L);
 
 	// string-buffer excution
 	template<typename RVal = void>
@@ -84,17 +119,117 @@ namespace lua_tinker
 		virtual ~lua_value() {}
 		virtual void to_lua(lua_State *L) = 0;
 	};
+
+	//read a lua string without copy (lua_tolstring), only valid while the lua string is alive (in a c++ function call, it's the argument)
+#if __cplusplus >= 201703L
+	typedef std::string_view string_view;
+#else
+	struct string_view
+	{
+		string_view() : m_data(""), m_size(0) {}
+		string_view(const char* data, size_t size) : m_data(data), m_size(size) {}
+		string_view(const char* data) : m_data(data), m_size(strlen(data)) {}
+		string_view(const std::string& str) : m_data(str.data()), m_size(str.size()) {}
+
+		const char* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		size_t length() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		const char* begin() const { return m_data; }
+		const char* end() const { return m_data + m_size; }
+		char operator[](size_t pos) const { return m_data[pos]; }
+		explicit operator std::string() const { return std::string(m_data, m_size); }
+
+		friend bool operator==(const string_view& lhs, const string_view& rhs)
+		{
+			return lhs.m_size == rhs.m_size && memcmp(lhs.m_data, rhs.m_data, lhs.m_size) == 0;
+		}
+		friend bool operator!=(const string_view& lhs, const string_view& rhs) { return !(lhs == rhs); }
+
+		const char* m_data;
+		size_t m_size;
+	};
+#endif
+
+	//push a proxy userdata which visits the c++ container directly (vector/deque/array/map/unordered_map...), no table is built.
+	//like a pointer, lua doesn't hold the container, keep it alive while lua uses the view.
+	//view<const std::vector<int>&> is readonly in lua, view<std::vector<int>&> allows v[i] = x / m[k] = x (m[k] = nil will erase)
+	template<typename T>
+	struct view
+	{
+		typedef typename std::remove_reference<T>::type container_type;
+		view(container_type& c) : m_p(&c) {}
+		container_type* m_p;
+	};
+	template<typename C>
+	view<C&> make_view(C& c) { return view<C&>(c); }
+
+	//contiguous float/double array, the buffer is owned by lua (created by num_array_def's constructor, 32 bytes aligned) or by c++ (pushed like a pointer)
+	//as a param it points to the buffer in userdata, only valid during the c++ function call; std::vector<T> param can also read from it by one memcpy
+	template<typename T>
+	struct num_array
+	{
+		static_assert(std::is_floating_point<T>::value, "num_array only support float/double");
+		num_array() : m_data(nullptr), m_size(0) {}
+		num_array(T* data, size_t size) : m_data(data), m_size(size) {}
+		num_array(std::vector<T>& vec) : m_data(vec.data()), m_size(vec.size()) {}
+
+		T* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		T* begin() const { return m_data; }
+		T* end() const { return m_data + m_size; }
+		T& operator[](size_t pos) const { return m_data[pos]; }
+
+		T* m_data;
+		size_t m_size;
+	};
+	//register a global constructor name(n)/name({...}) create a lua owned num_array<T>, methods: sum/dot/axpy/scale/min/max/clamp/gather/scatter/totable
+	template<typename T>
+	void num_array_def(lua_State* L, const char* name);
+
+	//return multi_return<int, float, bool>(...) from a c++ function, lua gets 3 results instead of a table
+	template<typename... Ts>
+	struct multi_return : public std::tuple<Ts...>
+	{
+		using std::tuple<Ts...>::tuple;
+		multi_return(std::tuple<Ts...>&& t) : std::tuple<Ts...>(std::move(t)) {}
+	};
+	//param out<T> of a c++ function, read from the lua argument (nil/none as default value), after the call it's returned to lua behind the return value
+	template<typename T>
+	struct out
+	{
+		out(lua_State* L, int idx, T&& val) : value(std::move(val)), m_L(L), m_idx(idx) {}
+		out(out&& rht) : value(std::move(rht.value)), m_L(rht.m_L), m_idx(rht.m_idx) { rht.m_L = nullptr; }
+		out(const out&) = delete;
+		~out();	//write value back to the argument's stack slot
+
+		out& operator=(const T& val) { value = val; return *this; }
+		T& operator*() { return value; }
+		T* operator->() { return &value; }
+
+		T value;
+		lua_State* m_L;
+		int m_idx;
+	};
+
+	struct stack_table;
 	struct table_onstack;
 	struct table_ref;
+	struct key;
 	struct args_type_overload_functor_base;
 
 	template<typename RVal = void>
 	struct lua_function_ref;
+	template<typename RVal = void>
+	struct lua_function_unique_ref;
 
 
 	// global function
 	template<typename Func, typename ... DefaultArgs>
 	void def(lua_State* L, const char* name, Func&& func, DefaultArgs&& ... default_args);
+	// global function bound at compile time, no upvalue when no default_args, def<LUATINKER_BIND(&func)>(L, name)
+	template<typename Func, Func func, typename ... DefaultArgs>
+	void def(lua_State* L, const char* name, DefaultArgs&& ... default_args);
 	// global variable
 	template<typename T>
 	void set(lua_State* L, const char* name, T&& object);
@@ -114,6 +249,8 @@ namespace lua_tinker
 	void namespace_set(lua_State* L, const char* namespace_name, const char* name, T&& object);
 	template<typename T>
 	T namespace_get(lua_State* L, const char* namespace_name, const char* name);
+	template<typename T>
+	T namespace_get(lua_State* L, const char* namespace_name, const key& name);
 
 
 
@@ -130,10 +267,19 @@ namespace lua_tinker
 	// Tinker Class Inheritance
 	template<typename T, typename P>
 	void class_inh(lua_State* L);
+	// Tinker Class Identity Cache, push the same T* / T& / shared_ptr<T> again will get the same userdata while it's alive
+	template<typename T>
+	void class_identity_cache(lua_State* L, bool bEnable = true);
+	// remove ptr from T's identity cache, must be called before the c++ obj destroyed
+	template<typename T>
+	void forget(lua_State* L, const T* ptr);
 
 	// Tinker Class Functions
 	template<typename T, typename Func, typename ... DefaultArgs>
 	void class_def(lua_State* L, const char* name, Func&& func, DefaultArgs&& ... default_args);
+	// class function bound at compile time, class_def<T, LUATINKER_BIND(&T::func)>(L, name)
+	template<typename T, typename Func, Func func, typename ... DefaultArgs>
+	void class_def(lua_State* L, const char* name, DefaultArgs&& ... default_args);
 	template<typename T, typename Func, typename ... DefaultArgs>
 	void class_def_static(lua_State* L, const char* name, Func&& func, DefaultArgs&& ... default_args);
 
@@ -160,57 +306,139 @@ namespace lua_tinker
 		int meta_get(lua_State *L);
 		int meta_set(lua_State *L);
 		int push_meta(lua_State *L, const char* name);
+		//a lua_pcall of lua_tinker failed, ++state_stats::m_nCallError
+		void count_call_error(lua_State *L);
+		//class_meta at nMetaIdx inherit from meta of parent_name, set __parent (or append to __multi_parent)
+		//under a light userdata key for the lookup and the string key for lua scripts, the string key is only a readonly view,
+		//a script assign class_meta.__parent does not change the inheritance
+		void meta_add_parent(lua_State *L, int nMetaIdx, const char* parent_name);
+
+		//class_meta's field table, key is the interned lua string ptr
+		struct var_base;
+		typedef void(*field_thunk_t)(lua_State *L, var_base* pVar);
+		//class_meta at nMetaIdx, key string at nKeyIdx, meta_get/meta_set will find pVar by the key ptr before rawget
+		void field_table_add(lua_State *L, int nMetaIdx, int nKeyIdx, var_base* pVar, field_thunk_t get_thunk, field_thunk_t set_thunk);
+#ifdef LUATINKER_INHERIT_CACHE
+		//remove all inherited members copied to derived metatable
+		void inherit_cache_flush(lua_State *L);
+		//__newindex of class_meta's metatable, flush cache then rawset
+		int inherit_cache_newindex(lua_State *L);
+#endif
+#ifdef LUATINKER_NATIVE_METHOD_INDEX
+		//set all class_meta's __index back to meta_get
+		void native_index_reset(lua_State *L);
+#endif
+		//flush the inherit cache after class_meta was changed by c++
+		inline void on_class_meta_changed(lua_State *L)
+		{
+#ifdef LUATINKER_INHERIT_CACHE
+			inherit_cache_flush(L);
+#endif
+#ifdef LUATINKER_NATIVE_METHOD_INDEX
+			native_index_reset(L);
+#endif
+		}
 	
 
 		template<typename T>
-		struct class_name
-		{
-			// global name
-			static const char* name(const char* name = NULL)
-			{
-				return name_str(name).c_str();
-			}
-			static const std::string& name_str(const char* name = NULL)
-			{
-				static std::string s_name;
-				if (name != NULL) s_name.assign(name);
-				return s_name;
-			}
-		};
+		using base_type = typename std::remove_cv<typename std::remove_reference<typename std::remove_pointer<T>::type>::type>::type;
+
+		//dense type index, 0 is invalid
+		size_t alloc_type_idx();
 
 		template<typename T>
-		using base_type = typename std::remove_cv<typename std::remove_reference<typename std::remove_pointer<T>::type>::type>::type;
+		size_t get_type_idx()
+		{
+			static const size_t s_type_idx = alloc_type_idx();
+			return s_type_idx;
+		}
+
+		//lua name of the type in this lua_State, set by class_add, "" if not registered.
+		//kept in the state's context indexed by type_idx, so each state can bind a type with a different name,
+		//the ptr is valid as long as the state, a later set_type_name of the same type does not free it
+		const char* get_type_name(lua_State* L, size_t type_idx);
+		void set_type_name(lua_State* L, size_t type_idx, const char* name);
 
 		template<typename T>
-		constexpr typename std::enable_if<!is_shared_ptr<T>::value, const char*>::type get_class_name()
+		typename std::enable_if<!is_shared_ptr<base_type<T>>::value, const char*>::type get_class_name(lua_State* L)
 		{
-			return class_name< base_type<T> >::name();
+			return get_type_name(L, get_type_idx<base_type<T>>());
 		}
 
 		template<typename T>
-		typename std::enable_if<is_shared_ptr<T>::value, const char*>::type get_class_name()
+		typename std::enable_if<is_shared_ptr<base_type<T>>::value, const char*>::type get_class_name(lua_State* L)
 		{
-			const std::string& strSharedName = class_name<T>::name_str();
-			if (strSharedName.empty())
-			{
+			const char* szSharedName = get_type_name(L, get_type_idx<base_type<T>>());
+			if (szSharedName[0] == '\0')
 				return S_SHARED_PTR_NAME;
-			}
-			else
-			{
-				return strSharedName.c_str();
-			}
+			return szSharedName;
+		}
+
+		//per-type key of the class metatable in LUA_REGISTRYINDEX, the address of s_key is unique for each T
+		template<typename T>
+		struct class_meta_key
+		{
+			static const void* key() { return &s_key; }
+			static const char s_key;
+		};
+		template<typename T>
+		const char class_meta_key<T>::s_key = 0;
 
+		//registry[class_meta_key<T>] = metatable on top, used by class_add
+		template<typename T>
+		void set_class_meta(lua_State *L)
+		{
+			lua_pushvalue(L, -1);
+			lua_rawsetp(L, LUA_REGISTRYINDEX, class_meta_key<base_type<T>>::key());
+		}
 
+		//push the cached metatable of T, don't need hash the class name like push_meta(L, name)
+		template<typename T>
+		typename std::enable_if<!is_shared_ptr<base_type<T>>::value, int>::type push_class_meta(lua_State *L)
+		{
+			return lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<base_type<T>>::key());
 		}
 
+		//unregistered shared_ptr use the default S_SHARED_PTR_NAME metatable
 		template<typename T>
-		constexpr const size_t get_type_idx()
+		typename std::enable_if<is_shared_ptr<base_type<T>>::value, int>::type push_class_meta(lua_State *L)
 		{
-			//convert all T to T*'s typeid's hash_code
-			return typeid(T*).hash_code();
+			int nType = lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<base_type<T>>::key());
+			if (nType == LUA_TNIL)
+			{
+				lua_pop(L, 1);
+				nType = lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<std::shared_ptr<void>>::key());
+			}
+			return nType;
 		}
 
 
+		//per-type key of the identity cache in LUA_REGISTRYINDEX, registry[key] = weak valued { [lightuserdata] = userdata }
+		template<typename T>
+		struct identity_cache_key
+		{
+			static const void* key() { return &s_key; }
+			static const char s_key;
+			//any lua_State enabled it, skip the registry lookup if not
+			static std::atomic<bool> s_enabled;
+		};
+		template<typename T>
+		const char identity_cache_key<T>::s_key = 0;
+		template<typename T>
+		std::atomic<bool> identity_cache_key<T>::s_enabled(false);
+
+		void _identity_cache_enable(lua_State* L, const void* key, bool bEnable);
+		//push the cached userdata of ptr and return its wapper, return nullptr and push nothing if not found
+		struct UserDataWapper;
+		UserDataWapper* _identity_cache_push(lua_State* L, const void* key, const void* ptr);
+		//cache[ptr] = userdata on top
+		void _identity_cache_store(lua_State* L, const void* key, const void* ptr);
+		void _identity_cache_forget(lua_State* L, const void* key, const void* ptr);
+
+		//setmetatable(obj at -2, class_meta at top) and pop class_meta, the class_meta's __gc is hidden when set,
+		//so lua won't put the non-owning userdata into the finalizer list
+		void _set_borrowed_metatable(lua_State* L);
+
 		struct lua_stack_scope_exit
 		{
 			int m_nOldTop;
@@ -226,20 +454,103 @@ namespace lua_tinker
 			}
 		};
 
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-		// inherit map
-		typedef std::multimap<size_t, size_t> InheritMap;
-		bool IsInherit(lua_State* L, size_t idTypeDerived, size_t idTypeBase);
-		void _addInheritMap(lua_State* L, size_t idTypeDerived, size_t idTypeBase);
+		// inherit cast table
+		typedef void*(*cast_func_t)(void*);
+
+		//how to convert a derived ptr to a base ptr
+		struct cast_entry
+		{
+			bool		m_valid = false;
+			//base = (char*)derived + m_offset, when m_steps is empty
+			ptrdiff_t	m_offset = 0;
+			//with virtual base, offset must be computed from obj, do every step in order
+			struct cast_step
+			{
+				ptrdiff_t	m_offset;
+				cast_func_t	m_func;
+			};
+			std::vector<cast_step> m_steps;
+
+			void* apply(void* p) const
+			{
+				if (p == nullptr)
+					return p;
+				if (m_steps.empty())
+					return (char*)p + m_offset;
+				for (const auto& step : m_steps)
+				{
+					p = step.m_func ? step.m_func(p) : (char*)p + step.m_offset;
+				}
+				return p;
+			}
+		};
+
+		//table[derived_idx][base_idx], the transitive closure of all class_inh
+		struct inherit_cast_table
+		{
+			std::vector< std::vector<cast_entry> > m_table;
+
+			const cast_entry* find(size_t idTypeDerived, size_t idTypeBase) const
+			{
+				if (idTypeDerived >= m_table.size())
+					return nullptr;
+				const auto& refRow = m_table[idTypeDerived];
+				if (idTypeBase >= refRow.size() || refRow[idTypeBase].m_valid == false)
+					return nullptr;
+				return &refRow[idTypeBase];
+			}
+			void add(size_t idTypeDerived, size_t idTypeBase, const cast_entry& entry);
+		};
+
+		const cast_entry* find_cast(lua_State* L, size_t idTypeDerived, size_t idTypeBase);
+		void _add_cast(lua_State* L, size_t idTypeDerived, size_t idTypeBase, const cast_entry& entry);
 
+		template<typename T, typename P, typename Enable = void>
+		struct is_virtual_base_of : std::true_type {};
+		//can static_cast base to derived, so it's not a virtual base
+		template<typename T, typename P>
+		struct is_virtual_base_of<T, P, typename std::enable_if<sizeof(static_cast<T*>(std::declval<P*>())) != 0>::type> : std::false_type {};
 
 		template<typename T, typename P>
-		void addInheritMap(lua_State* L)
+		void* _cast_to_base(void* p)
 		{
-			_addInheritMap(L, get_type_idx<base_type<T>>(), get_type_idx<base_type<P>>());
+			return static_cast<P*>(static_cast<T*>(p));
 		}
 
-#endif
+		//P is not a c++ base of T, only inherit in lua, use the same ptr
+		template<typename T, typename P>
+		typename std::enable_if<!std::is_base_of<P, T>::value, cast_entry>::type make_cast_entry()
+		{
+			cast_entry entry;
+			entry.m_valid = true;
+			return entry;
+		}
+
+		template<typename T, typename P>
+		typename std::enable_if<std::is_base_of<P, T>::value && !is_virtual_base_of<T, P>::value, cast_entry>::type make_cast_entry()
+		{
+			//static_cast to a non-virtual base only add a const offset, don't need a real obj
+			T* pFake = reinterpret_cast<T*>(alignof(T) * 64);
+			cast_entry entry;
+			entry.m_valid = true;
+			entry.m_offset = (char*)static_cast<P*>(pFake) - (char*)pFake;
+			return entry;
+		}
+
+		template<typename T, typename P>
+		typename std::enable_if<std::is_base_of<P, T>::value && is_virtual_base_of<T, P>::value, cast_entry>::type make_cast_entry()
+		{
+			cast_entry entry;
+			entry.m_valid = true;
+			entry.m_steps.push_back(cast_entry::cast_step{ 0, &_cast_to_base<T, P> });
+			return entry;
+		}
+
+		template<typename T, typename P>
+		void add_cast(lua_State* L)
+		{
+			_add_cast(L, get_type_idx<base_type<T>>(), get_type_idx<base_type<P>>(), make_cast_entry<base_type<T>, base_type<P>>());
+		}
 
 		// type trait
 		template<typename T> struct class_name;
@@ -257,6 +568,7 @@ namespace lua_tinker
 
 		template<typename T>
 		void push(lua_State *L, T ret);	//here need a T/T*/T& not a T&&
+		void push(lua_State *L, const key& ret);	//no copy of the ref
 
 		template<typename R, typename ...ARGS, typename ... DEFAULT_ARGS>
 		void _push_functor(lua_State* L, R(func)(ARGS...), DEFAULT_ARGS&& ... default_args);
@@ -302,78 +614,136 @@ namespace lua_tinker
 
 
 
-		//userdata holder
+		//userdata holder flags
+		enum UserDataFlag : uint8_t
+		{
+			UDF_OWNER	= 1 << 0,	//destroy the obj when gc
+			UDF_SHARED	= 1 << 1,	//hold a shared_ptr or weak_ptr
+			UDF_WEAK	= 1 << 2,	//hold a weak_ptr
+			UDF_CONST	= 1 << 3,	//pushed from a const ptr/ref
+		};
+
+		//userdata holder, no vtable, gc call the destroy func registered by type_idx
 		struct UserDataWapper
 		{
 			template<typename T>
-			explicit UserDataWapper(T* p)
+			explicit UserDataWapper(T* p, uint8_t nFlags = 0)
 				: m_p(p)
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-				, m_type_idx(get_type_idx<T>())
-#endif
+				, m_type_idx((uint32_t)get_type_idx<T>())
+				, m_flags(nFlags)
 			{}
 
 			//push a const to lua will lost constant qualifier
 			template<typename T>
 			explicit UserDataWapper(const T* p)
 				: m_p(const_cast<T*>(p))
-#ifdef LUATINKER_USERDATA_CHECK_CONST
-				, m_bConst(true)
-#endif
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-				, m_type_idx(get_type_idx<T>())
-#endif
+				, m_type_idx((uint32_t)get_type_idx<T>())
+				, m_flags(UDF_CONST)
 			{}
 
 
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
 			template<typename T>
-			explicit UserDataWapper(T* p, size_t nTypeIdx)
+			explicit UserDataWapper(T* p, size_t nTypeIdx, uint8_t nFlags)
 				: m_p(p)
-				, m_type_idx(nTypeIdx)
+				, m_type_idx((uint32_t)nTypeIdx)
+				, m_flags(nFlags)
 			{}
-#endif
 
-			virtual ~UserDataWapper() {}
-			virtual bool isSharedPtr() const { return false; }
-			virtual bool haveOwership() const { return false; }
+			bool isSharedPtr() const { return (m_flags & UDF_SHARED) != 0; }
+			bool haveOwership() const { return (m_flags & UDF_OWNER) != 0; }
+			bool is_weak() const { return (m_flags & UDF_WEAK) != 0; }
+			bool is_const() const { return (m_flags & UDF_CONST) != 0; }
 
 			void* m_p;
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-			size_t  m_type_idx;
-#endif
-
-#ifdef LUATINKER_USERDATA_CHECK_CONST
-			bool is_const() const { return m_bConst; }
-			bool m_bConst = false;
-#endif
+			uint32_t m_type_idx;
+			uint8_t m_flags;
 		};
 
+		//per type destroy func table
+		typedef void(*userdata_destroy_func_t)(UserDataWapper*);
+		void _register_userdata_destroy(size_t nTypeIdx, bool bWeak, userdata_destroy_func_t func);
+		//__gc of all class meta
+		int userdata_destroyer(lua_State *L);
+
+		template<typename W>
+		void _userdata_destroy(UserDataWapper* p)
+		{
+			static_cast<W*>(p)->~W();
+		}
+
+		template<typename W>
+		void register_userdata_destroy(size_t nTypeIdx, bool bWeak)
+		{
+			static const bool s_registered = (_register_userdata_destroy(nTypeIdx, bWeak, &_userdata_destroy<W>), true);
+			(void)s_registered;
+		}
+
 		template <class... Args>
 		struct class_tag
 		{
 		};
 
-		template<typename T>
+		//same as LUAI_MAXALIGN, lua_newuserdata's memory is aligned to it
+		union userdata_max_align_t
+		{
+			lua_Number n;
+			double u;
+			void* s;
+			lua_Integer i;
+			long l;
+		};
+
+		//T is constructed in the same userdata memory, only over-aligned T need alloc from heap
+		template<typename T, bool bInline = (alignof(T) <= alignof(userdata_max_align_t))>
 		struct val2user : UserDataWapper
 		{
-			val2user() : UserDataWapper(new T) { }
-			val2user(const T& t) : UserDataWapper(new T(t)) {}
-			val2user(T&& t) : UserDataWapper(new T(std::forward<T>(t))) {}
+			val2user() : UserDataWapper((T*)nullptr) { m_p = new(&m_storage) T; on_constructed(); }
+			val2user(const T& t) : UserDataWapper((T*)nullptr) { m_p = new(&m_storage) T(t); on_constructed(); }
+			val2user(T&& t) : UserDataWapper((T*)nullptr) { m_p = new(&m_storage) T(std::forward<T>(t)); on_constructed(); }
+
+			//direct read args, use type_list to help hold Args
+			template<typename ...Args, size_t ...index>
+			val2user(lua_State* L, std::index_sequence<index...>, class_tag<Args...> tag)
+				: UserDataWapper((T*)nullptr)
+			{
+				m_p = new(&m_storage) T(read<Args>(L, 2 + index)...);
+				on_constructed();
+			}
+
+			template<typename ...Args>
+			val2user(lua_State* L, class_tag<Args...> tag)
+				: val2user(L, std::make_index_sequence<sizeof...(Args)>(), tag)
+			{}
 
-			//tuple is hold the params, so unpack it
-			//template<typename Tup, size_t ...index>
-			//val2user(Tup&& tup, std::index_sequence<index...>) : UserDataWapper(new T(std::get<index>(std::forward<Tup>(tup))...)) {}
+			val2user(lua_State* L, class_tag<void> tag)
+				: val2user()
+			{}
+
+			void on_constructed()
+			{
+				m_flags |= UDF_OWNER;
+				register_userdata_destroy<val2user>(m_type_idx, false);
+			}
 
-			//template<typename Tup,typename = typename std::enable_if<is_tuple<Tup>::value, void>::type >
-			//val2user(Tup&& tup) : val2user(std::forward<Tup>(tup), std::make_index_sequence<std::tuple_size<typename std::decay<Tup>::type>::value>{}) {}
+			~val2user() { if (m_p) ((T*)m_p)->~T(); }
+
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+		};
 
+		template<typename T>
+		struct val2user<T, false> : UserDataWapper
+		{
+			val2user() : UserDataWapper(new T, UDF_OWNER) { on_constructed(); }
+			val2user(const T& t) : UserDataWapper(new T(t), UDF_OWNER) { on_constructed(); }
+			val2user(T&& t) : UserDataWapper(new T(std::forward<T>(t)), UDF_OWNER) { on_constructed(); }
 
 			//direct read args, use type_list to help hold Args
 			template<typename ...Args, size_t ...index>
 			val2user(lua_State* L, std::index_sequence<index...>, class_tag<Args...> tag)
-				: UserDataWapper(new T(read<Args>(L, 2 + index)...))
-			{}
+				: UserDataWapper(new T(read<Args>(L, 2 + index)...), UDF_OWNER)
+			{
+				on_constructed();
+			}
 
 			template<typename ...Args>
 			val2user(lua_State* L, class_tag<Args...> tag)
@@ -384,7 +754,7 @@ namespace lua_tinker
 				: val2user()
 			{}
 
-			virtual bool haveOwership() const { return true; }
+			void on_constructed() { register_userdata_destroy<val2user>(m_type_idx, false); }
 
 			~val2user() { delete ((T*)m_p); }
 
@@ -410,14 +780,13 @@ namespace lua_tinker
 		{
 			weakptr2user(const std::shared_ptr<T>& rht)
 				:UserDataWapper(&m_holder
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
 					, get_type_idx<std::shared_ptr<T>>()
-#endif
-					)
+					, UDF_SHARED | UDF_WEAK)
 				, m_holder(rht)
-			{}
+			{
+				register_userdata_destroy<weakptr2user>(m_type_idx, true);
+			}
 
-			virtual bool isSharedPtr() const override { return true; }
 			//use weak_ptr to hold it
 			~weakptr2user() { m_holder.reset(); }
 
@@ -429,22 +798,20 @@ namespace lua_tinker
 		{
 			sharedptr2user(const std::shared_ptr<T>& rht)
 				:UserDataWapper(&m_holder
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
 					, get_type_idx<std::shared_ptr<T>>()
-#endif
-					)
+					, UDF_SHARED | UDF_OWNER)
 				, m_holder(rht)
-			{}
+			{
+				register_userdata_destroy<sharedptr2user>(m_type_idx, false);
+			}
 			sharedptr2user(std::shared_ptr<T>&& rht)
 				:UserDataWapper(&m_holder
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
 					, get_type_idx<std::shared_ptr<T>>()
-#endif
-					)
+					, UDF_SHARED | UDF_OWNER)
 				, m_holder(std::forward<std::shared_ptr<T>>(rht))
-			{}
-			virtual bool isSharedPtr() const override { return true; }
-			virtual bool haveOwership() const override { return true; }
+			{
+				register_userdata_destroy<sharedptr2user>(m_type_idx, false);
+			}
 			//use weak_ptr to hold it
 			~sharedptr2user() { m_holder.reset(); }
 
@@ -498,6 +865,14 @@ namespace lua_tinker
 			static table_onstack apply(lua_State *L);
 		};
 
+		//leave the table on stack, the caller pops it
+		template<>
+		struct pop<stack_table>
+		{
+			static constexpr const int nresult = 1;
+			static stack_table apply(lua_State *L);
+		};
+
 		// push value_list to lua stack //here need a T/T*/T& not a T&&
 		void push_args(lua_State *L);
 		template<typename T, typename ...Args>
@@ -576,35 +951,42 @@ namespace lua_tinker
 				return CLT_INT;
 		}
 		
+		//convert the obj ptr in userdata to a base_type<_T>*, adjust it if _T is a base of the obj's type
 		template<typename _T>
-		static typename std::enable_if<!std::is_same<void*, base_type<_T> >::value, void>::type UserDataCheckType(UserDataWapper* pWapper,lua_State *L, int index)
+		static typename std::enable_if<!std::is_same<void*, base_type<_T> >::value, void*>::type UserDataCast(UserDataWapper* pWapper,lua_State *L, int index)
 		{
+			void* p = pWapper->m_p;
+			if (pWapper->m_type_idx != get_type_idx<base_type<_T>>())
+			{
+				//maybe derived to base
+				const cast_entry* pCast = find_cast(L, pWapper->m_type_idx, get_type_idx<base_type<_T>>());
+				if (pCast != nullptr)
+				{
+					p = pCast->apply(p);
+				}
 		#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-				if (pWapper->m_type_idx != get_type_idx<base_type<_T>>())
+				else
 				{
-					//maybe derived to base
-					if (IsInherit(L, pWapper->m_type_idx, get_type_idx<base_type<_T>>()) == false)
-					{
-						lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<_T>());
-						lua_error(L);
-					}
+					lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<_T>(L));
+					lua_error(L);
 				}
 		#endif
+			}
 		#ifdef LUATINKER_USERDATA_CHECK_CONST
 				if( (std::is_reference<_T>::value || std::is_pointer<_T>::value) &&
 					pWapper->is_const() == true && std::is_const<typename std::remove_reference<typename std::remove_pointer<_T>::type>::type>::value == false)
 				{
-					lua_pushfstring(L, "can't convert argument %d from const class %s", index, get_class_name<_T>());
+					lua_pushfstring(L, "can't convert argument %d from const class %s", index, get_class_name<_T>(L));
 					lua_error(L);			
 				}
 		#endif
-			
+			return p;
 		}
 		
 		template<typename _T>
-		static typename std::enable_if<std::is_same<void*, base_type<_T> >::value, void>::type UserDataCheckType(UserDataWapper* pWapper,lua_State *L, int index)
+		static typename std::enable_if<std::is_same<void*, base_type<_T> >::value, void*>::type UserDataCast(UserDataWapper* pWapper,lua_State *L, int index)
 		{
-			return;
+			return pWapper->m_p;
 		}
 
 		
@@ -613,26 +995,53 @@ namespace lua_tinker
 		{
 			if (!lua_isuserdata(L, index))
 			{
-				lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<_T>());
+				lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<_T>(L));
 				lua_error(L);
 				
 			}
 
 
 			UserDataWapper* pWapper = user2type<UserDataWapper*>(L, index);
-			UserDataCheckType<_T>(pWapper,L,index);
-			return void2type<_T>(pWapper->m_p);
+			return void2type<_T>(UserDataCast<_T>(pWapper, L, index));
 
 		}
 
 		template<typename _T>
-		static void _type2lua(lua_State *L, _T&& val)
+		static typename std::enable_if<std::is_pointer<_T>::value, const void*>::type _identity_ptr(const _T& val) { return val; }
+		template<typename _T>
+		static typename std::enable_if<std::is_reference<_T>::value, const void*>::type _identity_ptr(const _T& val) { return &val; }
+
+		template<typename _T>
+		static typename std::enable_if<!std::is_pointer<_T>::value && !std::is_reference<_T>::value, void>::type _type2lua(lua_State *L, _T&& val)
 		{
 			object2lua(L, std::forward<_T>(val));
-			push_meta(L, get_class_name<_T>());
+			push_class_meta<_T>(L);
 			lua_setmetatable(L, -2);
 		}
 
+		//ptr and ref may reuse the userdata in identity cache
+		template<typename _T>
+		static typename std::enable_if<std::is_pointer<_T>::value || std::is_reference<_T>::value, void>::type _type2lua(lua_State *L, _T&& val)
+		{
+			typedef identity_cache_key<base_type<_T>> cache_key;
+			const void* ptr = nullptr;
+			if (cache_key::s_enabled.load(std::memory_order_relaxed) && (ptr = _identity_ptr<_T>(val)) != nullptr)
+			{
+				UserDataWapper* pWapper = _identity_cache_push(L, cache_key::key(), ptr);
+				if (pWapper != nullptr)
+				{
+					if (pWapper->is_const() == std::is_const<typename std::remove_reference<typename std::remove_pointer<_T>::type>::type>::value)
+						return;
+					lua_pop(L, 1);	//different const qualifier, replace it
+				}
+			}
+			object2lua(L, std::forward<_T>(val));
+			push_class_meta<_T>(L);
+			_set_borrowed_metatable(L);
+			if (ptr != nullptr)
+				_identity_cache_store(L, cache_key::key(), ptr);
+		}
+
 		// lua stack help to read/push
 		template<typename T, typename Enable>
 		struct _stack_help
@@ -746,6 +1155,40 @@ namespace lua_tinker
 		{
 		};
 
+		//no copy, point to the lua string
+		template<>
+		struct _stack_help<string_view>
+		{
+			static constexpr int cover_to_lua_type() { return CLT_STRING; }
+
+			static string_view _read(lua_State *L, int index);
+			static void _push(lua_State *L, const string_view& ret);
+		};
+		template<>
+		struct _stack_help<const string_view&> : public _stack_help<string_view>
+		{
+		};
+
+		//push the pinned string, can't read back
+		template<>
+		struct _stack_help<key>
+		{
+			static constexpr int cover_to_lua_type() { return CLT_STRING; }
+			static void _push(lua_State *L, const key& ret);
+		};
+		template<>
+		struct _stack_help<const key&> : public _stack_help<key>
+		{
+		};
+
+
+		template<>
+		struct _stack_help<stack_table>
+		{
+			static constexpr int cover_to_lua_type() { return CLT_TABLE; }
+			static stack_table _read(lua_State *L, int index);
+			static void _push(lua_State *L, const stack_table& ret);
+		};
 
 		template<>
 		struct _stack_help<table_onstack>
@@ -794,14 +1237,24 @@ namespace lua_tinker
 			table_iterator it(table_obj);
 			while (it.hasNext())
 			{
-				t.emplace(std::make_pair(read<typename _T::key_type>(L, it.key_idx()), read<typename _T::mapped_type>(L, it.value_idx())));
+				t.emplace(read<typename _T::key_type>(L, it.key_idx()), read<typename _T::mapped_type>(L, it.value_idx()));
 				it.moveNext();
 			}
 
 			return t;
 		}
 
-		//support list,vector,deque
+		template<typename _T>
+		static typename std::enable_if<has_reserve<_T>::value>::type _reserve(_T& t, size_t nSize)
+		{
+			t.reserve(nSize);
+		}
+		template<typename _T>
+		static typename std::enable_if<!has_reserve<_T>::value>::type _reserve(_T& t, size_t nSize)
+		{
+		}
+
+		//support list,vector,deque, read t[1..#t] by rawgeti
 		template<typename _T>
 		static typename std::enable_if<!is_associative_container<_T>::value && !has_key_type<_T>::value, _T>::type _readfromtable(lua_State *L, int index)
 		{
@@ -811,14 +1264,16 @@ namespace lua_tinker
 				lua_pushfstring(L, "convert container from argument %d must be a table", index);
 				lua_error(L);
 			}
-
+			luaL_checkstack(L, 2, "read nested container");
 
 			_T t;
-			table_iterator it(table_obj);
-			while (it.hasNext())
+			size_t nLen = lua_rawlen(L, table_obj._stack_pos);
+			_reserve(t, nLen);
+			for (size_t i = 1; i <= nLen; i++)
 			{
-				t.emplace_back(read<typename _T::value_type>(L, it.value_idx()));
-				it.moveNext();
+				lua_rawgeti(L, table_obj._stack_pos, i);
+				t.emplace_back(read<typename _T::value_type>(L, -1));
+				lua_pop(L, 1);
 			}
 
 			return t;
@@ -846,46 +1301,176 @@ namespace lua_tinker
 			return t;
 		}
 
-		//k,v container to lua
 		template<typename _T>
-		static typename std::enable_if<is_associative_container<_T>::value, void>::type  _pushtotable(lua_State *L, const _T& ret)
+		static typename std::enable_if<is_associative_container<_T>::value, void>::type  _pushtotable(lua_State *L, const _T& ret);
+		template<typename _T>
+		static typename std::enable_if<!is_associative_container<_T>::value, void>::type  _pushtotable(lua_State *L, const _T& ret);
+
+		//push a element of container, nested stl container push to a table without copy
+		template<typename _T>
+		static void _push_element(lua_State *L, const _T& val, std::integral_constant<int, CLT_TABLE>)
 		{
-			stack_obj table_obj = stack_obj::new_table(L, 0, ret.size());
-			for (auto it = ret.begin(); it != ret.end(); it++)
-			{
-				push(L, it->first);
-				push(L, it->second);
-				lua_settable(L, table_obj._stack_pos);
-			}
+			_pushtotable(L, val);
 		}
-		//t container to lua
+		//number/string push by value or const ref
 		template<typename _T>
-		static typename std::enable_if<!is_associative_container<_T>::value, void>::type  _pushtotable(lua_State *L, const _T& ret)
+		static void _push_element(lua_State *L, const _T& val, std::integral_constant<int, CLT_STRING>)
 		{
-			stack_obj table_obj = stack_obj::new_table(L, ret.size(), 0);
-			auto it = ret.begin();
-			for (int i = 1; it != ret.end(); it++, i++)
-			{
-				push(L, i);
-				push(L, *it);
-				lua_settable(L, table_obj._stack_pos);
-			}
+			_stack_help<_T>::_push(L, val);
 		}
-
-		//stl container T
-		template<typename T>
-		struct _stack_help<T, typename std::enable_if<!std::is_reference<T>::value && !std::is_pointer<T>::value && is_container<base_type<T>>::value>::type>
+		template<typename _T, int nType>
+		static void _push_element(lua_State *L, const _T& val, std::integral_constant<int, nType>)
+		{
+			push(L, val);
+		}
+		template<typename _T>
+		static void _push_element(lua_State *L, const _T& val)
+		{
+			typedef std::integral_constant<int,
+				(is_container<_T>::value && _stack_help<_T>::cover_to_lua_type() == CLT_TABLE) ? CLT_TABLE :
+				(std::is_arithmetic<_T>::value || std::is_enum<_T>::value || _stack_help<_T>::cover_to_lua_type() == CLT_STRING) ? CLT_STRING : CLT_NONE> kind_t;
+			_push_element(L, val, kind_t());
+		}
+
+		//k,v container to lua
+		template<typename _T>
+		static typename std::enable_if<is_associative_container<_T>::value, void>::type  _pushtotable(lua_State *L, const _T& ret)
+		{
+			luaL_checkstack(L, 3, "push nested container");
+			lua_createtable(L, 0, (int)ret.size());
+			for (auto it = ret.begin(); it != ret.end(); it++)
+			{
+				_push_element(L, it->first);
+				_push_element(L, it->second);
+				lua_rawset(L, -3);
+			}
+		}
+		//t container to lua
+		template<typename _T>
+		static typename std::enable_if<!is_associative_container<_T>::value, void>::type  _pushtotable(lua_State *L, const _T& ret)
+		{
+			luaL_checkstack(L, 2, "push nested container");
+			lua_createtable(L, (int)ret.size(), 0);
+			lua_Integer i = 1;
+			for (auto it = ret.begin(); it != ret.end(); it++, i++)
+			{
+				_push_element(L, *it);
+				lua_rawseti(L, -2, i);
+			}
+		}
+
+		//byte container <-> lua string
+		template<typename T>
+		struct is_byte_container : public std::false_type {};
+		template<typename A>
+		struct is_byte_container<std::vector<uint8_t, A>> : public std::true_type {};
+		template<typename A>
+		struct is_byte_container<std::vector<char, A>> : public std::true_type {};
+		template<std::size_t N>
+		struct is_byte_container<std::array<uint8_t, N>> : public std::true_type {};
+		template<std::size_t N>
+		struct is_byte_container<std::array<char, N>> : public std::true_type {};
+
+		template<typename T>
+		struct is_std_array : public std::false_type {};
+		template<typename T, std::size_t N>
+		struct is_std_array<std::array<T, N>> : public std::true_type {};
+
+		template<typename _T>
+		static typename std::enable_if<!is_std_array<_T>::value, _T>::type _readfrombytes(const char* pData, size_t nLen)
+		{
+			return _T(pData, pData + nLen);
+		}
+		//std::array copy the front N bytes, fill the rest with 0
+		template<typename _T>
+		static typename std::enable_if<is_std_array<_T>::value, _T>::type _readfrombytes(const char* pData, size_t nLen)
+		{
+			_T t;
+			size_t nCopy = nLen < t.size() ? nLen : t.size();
+			memcpy(t.data(), pData, nCopy);
+			memset(t.data() + nCopy, 0, t.size() - nCopy);
+			return t;
+		}
+
+		//vector<uint8_t>/vector<char>/array<uint8_t,N>/array<char,N> and their const ref, push as a lua string, read from a lua string (or a table)
+		template<typename T>
+		struct _stack_help<T, typename std::enable_if<!std::is_pointer<T>::value && is_byte_container<base_type<T>>::value &&
+			(!std::is_reference<T>::value || std::is_const<typename std::remove_reference<T>::type>::value)>::type>
+		{
+			typedef base_type<T> ContainerType;
+			static constexpr int cover_to_lua_type() { return CLT_STRING; }
+
+			static ContainerType _read(lua_State *L, int index)
+			{
+				if (lua_type(L, index) == LUA_TSTRING)
+				{
+					size_t nLen = 0;
+					const char* pData = lua_tolstring(L, index, &nLen);
+					return _readfrombytes<ContainerType>(pData, nLen);
+				}
+				return _read_nostring<ContainerType>(L, index);
+			}
+
+			//a byte table is still allowed for vector
+			template<typename _T>
+			static typename std::enable_if<!is_std_array<_T>::value, _T>::type _read_nostring(lua_State *L, int index)
+			{
+				if (lua_istable(L, index) == false)
+				{
+					lua_pushfstring(L, "convert byte container from argument %d must be a string", index);
+					lua_error(L);
+				}
+				return _readfromtable<_T>(L, index);
+			}
+			template<typename _T>
+			static typename std::enable_if<is_std_array<_T>::value, _T>::type _read_nostring(lua_State *L, int index)
+			{
+				lua_pushfstring(L, "convert byte container from argument %d must be a string", index);
+				lua_error(L);
+				return _T();
+			}
+
+			static void _push(lua_State *L, const ContainerType& val)
+			{
+				lua_pushlstring(L, (const char*)val.data(), val.size());
+			}
+		};
+
+		template<typename T>
+		struct num_array_meta;
+
+		//stl container T
+		template<typename T>
+		struct _stack_help<T, typename std::enable_if<!std::is_reference<T>::value && !std::is_pointer<T>::value && is_container<base_type<T>>::value && !is_byte_container<base_type<T>>::value>::type>
 		{
 			static constexpr int cover_to_lua_type() { return CLT_TABLE; }
 
+			typedef std::integral_constant<bool, std::is_same<base_type<T>, std::vector<float>>::value || std::is_same<base_type<T>, std::vector<double>>::value> is_num_vector;
+
 			static T _read(lua_State *L, int index)
 			{
 				if (lua_istable(L, index))
 					return _readfromtable<T>(L, index);
 				else
 				{
-					return _lua2type<T>(L, index);
+					return _read_nottable(L, index, is_num_vector());
+				}
+			}
+
+			static T _read_nottable(lua_State *L, int index, std::false_type)
+			{
+				return _lua2type<T>(L, index);
+			}
+			//std::vector<float/double> read from a num_array by one copy
+			static T _read_nottable(lua_State *L, int index, std::true_type)
+			{
+				typedef typename base_type<T>::value_type value_type;
+				if (num_array_meta<value_type>::is_num_array(L, index))
+				{
+					num_array<value_type>* pArray = num_array_meta<value_type>::get(L, index);
+					return base_type<T>(pArray->begin(), pArray->end());
 				}
+				return _lua2type<T>(L, index);
 			}
 
 			template<typename _T>
@@ -907,6 +1492,599 @@ namespace lua_tinker
 
 		};
 		
+		//metatable of view<C>: __index/__newindex/__len/__pairs/__ipairs work on the c++ container
+		template<typename C>
+		struct view_meta
+		{
+			typedef typename std::remove_const<C>::type container_type;
+			typedef typename container_type::value_type value_type;
+			enum { is_map = is_associative_container<container_type>::value };
+			static_assert(is_map || std::is_same<typename std::iterator_traits<typename container_type::iterator>::iterator_category, std::random_access_iterator_tag>::value,
+				"view only support random access container or k-v container");
+
+			static C* get(lua_State *L, int index)
+			{
+				return *(C**)lua_touserdata(L, index);
+			}
+
+			//element as value: number/string, nested container as a view, others as a pointer
+			template<typename E>
+			static void _push_value(lua_State *L, E& val, std::integral_constant<int, CLT_TABLE>)
+			{
+				push(L, view<E&>(val));
+			}
+			template<typename E>
+			static void _push_value(lua_State *L, E& val, std::integral_constant<int, CLT_STRING>)
+			{
+				_stack_help<typename std::remove_const<E>::type>::_push(L, val);
+			}
+			//a class object is pushed as a ptr to the element, ptr/shared_ptr/other values are pushed as they are
+			template<typename E>
+			static void _push_value(lua_State *L, E& val, std::integral_constant<int, CLT_USERDATA>)
+			{
+				typedef typename std::remove_const<E>::type RawE;
+				_push_object(L, val, std::integral_constant<bool, std::is_class<RawE>::value && is_shared_ptr<RawE>::value == false
+					&& _stack_help<RawE>::cover_to_lua_type() == CLT_USERDATA>());
+			}
+			template<typename E>
+			static void _push_object(lua_State *L, E& val, std::true_type)
+			{
+				push(L, &val);
+			}
+			template<typename E>
+			static void _push_object(lua_State *L, E& val, std::false_type)
+			{
+				push(L, val);
+			}
+			template<typename E>
+			static void _push_value(lua_State *L, E& val)
+			{
+				typedef typename std::remove_const<E>::type RawE;
+				typedef std::integral_constant<int,
+					(is_container<RawE>::value && _stack_help<RawE>::cover_to_lua_type() == CLT_TABLE) ? CLT_TABLE :
+					(std::is_arithmetic<RawE>::value || std::is_enum<RawE>::value || _stack_help<RawE>::cover_to_lua_type() == CLT_STRING) ? CLT_STRING : CLT_USERDATA> kind_t;
+				_push_value(L, val, kind_t());
+			}
+
+			//t[i], 1 <= i <= #t
+			static bool _get_seq_index(lua_State *L, C* pContainer, int index, size_t& nIdx)
+			{
+				int isnum = 0;
+				lua_Integer n = lua_tointegerx(L, index, &isnum);
+				if (isnum == 0 || n < 1 || (size_t)n > pContainer->size())
+					return false;
+				nIdx = (size_t)n - 1;
+				return true;
+			}
+
+			template<bool bMap = is_map>
+			static typename std::enable_if<!bMap, int>::type meta_index(lua_State *L)
+			{
+				C* pContainer = get(L, 1);
+				size_t nIdx = 0;
+				if (_get_seq_index(L, pContainer, 2, nIdx) == false)
+					return 0;
+				_push_value(L, (*pContainer)[nIdx]);
+				return 1;
+			}
+			template<bool bMap = is_map>
+			static typename std::enable_if<bMap, int>::type meta_index(lua_State *L)
+			{
+				C* pContainer = get(L, 1);
+				auto it = pContainer->find(read<typename container_type::key_type>(L, 2));
+				if (it == pContainer->end())
+					return 0;
+				_push_value(L, it->second);
+				return 1;
+			}
+
+			template<bool bMap = is_map>
+			static typename std::enable_if<!bMap, int>::type meta_newindex(lua_State *L)
+			{
+				C* pContainer = get(L, 1);
+				size_t nIdx = 0;
+				if (_get_seq_index(L, pContainer, 2, nIdx) == false)
+				{
+					lua_pushfstring(L, "view index out of range [1, %d]", (int)pContainer->size());
+					lua_error(L);
+				}
+				(*pContainer)[nIdx] = read<value_type>(L, 3);
+				return 0;
+			}
+			template<bool bMap = is_map>
+			static typename std::enable_if<bMap, int>::type meta_newindex(lua_State *L)
+			{
+				C* pContainer = get(L, 1);
+				auto key = read<typename container_type::key_type>(L, 2);
+				auto it = pContainer->find(key);
+				if (lua_isnil(L, 3))
+				{
+					if (it != pContainer->end())
+						pContainer->erase(it);
+				}
+				else if (it != pContainer->end())
+					it->second = read<typename container_type::mapped_type>(L, 3);
+				else
+					pContainer->emplace(std::move(key), read<typename container_type::mapped_type>(L, 3));
+				return 0;
+			}
+
+			static int meta_readonly(lua_State *L)
+			{
+				lua_pushstring(L, "can't modify a const view");
+				lua_error(L);
+				return 0;
+			}
+
+			static int meta_len(lua_State *L)
+			{
+				lua_pushinteger(L, (lua_Integer)get(L, 1)->size());
+				return 1;
+			}
+
+			//next(view, key), find the key again each step, still work when the container was modified
+			template<bool bMap = is_map>
+			static typename std::enable_if<!bMap, int>::type meta_next(lua_State *L)
+			{
+				C* pContainer = get(L, 1);
+				lua_Integer n = lua_isnil(L, 2) ? 0 : lua_tointeger(L, 2);
+				if (n < 0 || (size_t)n >= pContainer->size())
+					return 0;
+				lua_pushinteger(L, n + 1);
+				_push_value(L, (*pContainer)[(size_t)n]);
+				return 2;
+			}
+			template<bool bMap = is_map>
+			static typename std::enable_if<bMap, int>::type meta_next(lua_State *L)
+			{
+				C* pContainer = get(L, 1);
+				auto it = pContainer->begin();
+				if (lua_isnil(L, 2) == false)
+				{
+					it = pContainer->find(read<typename container_type::key_type>(L, 2));
+					if (it != pContainer->end())
+						++it;
+				}
+				if (it == pContainer->end())
+					return 0;
+				_push_value(L, it->first);
+				_push_value(L, it->second);
+				return 2;
+			}
+
+			static int meta_pairs(lua_State *L)
+			{
+				lua_pushcfunction(L, &meta_next<>);
+				lua_pushvalue(L, 1);
+				lua_pushnil(L);
+				return 3;
+			}
+
+			static bool is_view(lua_State *L, int index)
+			{
+				if (lua_getmetatable(L, index) == 0)
+					return false;
+				lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<view_meta<C>>::key());
+				bool bIsView = lua_rawequal(L, -1, -2) != 0;
+				lua_pop(L, 2);
+				return bIsView;
+			}
+
+			//registry[class_meta_key<view_meta<C>>] = metatable
+			static void push_meta(lua_State *L)
+			{
+				if (lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<view_meta<C>>::key()) == LUA_TTABLE)
+					return;
+				lua_pop(L, 1);
+
+				lua_createtable(L, 0, 6);
+				lua_pushcfunction(L, &meta_index<>);
+				lua_setfield(L, -2, "__index");
+				lua_pushcfunction(L, meta_newindex_if_fn<C>());
+				lua_setfield(L, -2, "__newindex");
+				lua_pushcfunction(L, &meta_len);
+				lua_setfield(L, -2, "__len");
+				lua_pushcfunction(L, &meta_pairs);
+				lua_setfield(L, -2, "__pairs");
+				lua_pushcfunction(L, &meta_pairs);
+				lua_setfield(L, -2, "__ipairs");
+				lua_pushstring(L, "lua_tinker::view");
+				lua_setfield(L, -2, "__name");
+
+				lua_pushvalue(L, -1);
+				lua_rawsetp(L, LUA_REGISTRYINDEX, class_meta_key<view_meta<C>>::key());
+			}
+
+			//meta_newindex only be instantiated for a non-const container
+			template<typename _C>
+			static typename std::enable_if<!std::is_const<_C>::value, lua_CFunction>::type meta_newindex_if_fn() { return &meta_newindex<>; }
+			template<typename _C>
+			static typename std::enable_if<std::is_const<_C>::value, lua_CFunction>::type meta_newindex_if_fn() { return &meta_readonly; }
+		};
+
+		template<typename T>
+		struct _stack_help<view<T>>
+		{
+			typedef typename view<T>::container_type C;
+			static constexpr int cover_to_lua_type() { return CLT_USERDATA; }
+
+			static bool _is_view(lua_State *L, int index, std::false_type)
+			{
+				return view_meta<C>::is_view(L, index);
+			}
+			//a const view can read from a non-const view
+			static bool _is_view(lua_State *L, int index, std::true_type)
+			{
+				return view_meta<C>::is_view(L, index) || view_meta<typename std::remove_const<C>::type>::is_view(L, index);
+			}
+
+			static view<T> _read(lua_State *L, int index)
+			{
+				if (_is_view(L, index, std::is_const<C>()) == false)
+				{
+					lua_pushfstring(L, "can't convert argument %d to view", index);
+					lua_error(L);
+				}
+				return view<T>(*view_meta<C>::get(L, index));
+			}
+			static void _push(lua_State *L, const view<T>& val)
+			{
+				*(C**)lua_newuserdata(L, sizeof(C*)) = val.m_p;
+				view_meta<C>::push_meta(L);
+				lua_setmetatable(L, -2);
+			}
+		};
+
+		//bulk kernels of num_array, written as plain loops for the compiler to vectorize
+		template<typename T>
+		struct num_array_kernel
+		{
+			static T sum(const T* p, size_t n)
+			{
+				T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+				size_t i = 0;
+				for (; i + 4 <= n; i += 4)
+				{
+					s0 += p[i]; s1 += p[i + 1]; s2 += p[i + 2]; s3 += p[i + 3];
+				}
+				for (; i < n; i++)
+					s0 += p[i];
+				return (s0 + s1) + (s2 + s3);
+			}
+			static T dot(const T* a, const T* b, size_t n)
+			{
+				T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+				size_t i = 0;
+				for (; i + 4 <= n; i += 4)
+				{
+					s0 += a[i] * b[i]; s1 += a[i + 1] * b[i + 1]; s2 += a[i + 2] * b[i + 2]; s3 += a[i + 3] * b[i + 3];
+				}
+				for (; i < n; i++)
+					s0 += a[i] * b[i];
+				return (s0 + s1) + (s2 + s3);
+			}
+			//y += a * x
+			static void axpy(T* y, T a, const T* x, size_t n)
+			{
+				for (size_t i = 0; i < n; i++)
+					y[i] += a * x[i];
+			}
+			static void scale(T* p, T a, size_t n)
+			{
+				for (size_t i = 0; i < n; i++)
+					p[i] *= a;
+			}
+			static void clamp(T* p, T lo, T hi, size_t n)
+			{
+				for (size_t i = 0; i < n; i++)
+					p[i] = p[i] < lo ? lo : (p[i] > hi ? hi : p[i]);
+			}
+			static T min(const T* p, size_t n)
+			{
+				T v = p[0];
+				for (size_t i = 1; i < n; i++)
+					v = p[i] < v ? p[i] : v;
+				return v;
+			}
+			static T max(const T* p, size_t n)
+			{
+				T v = p[0];
+				for (size_t i = 1; i < n; i++)
+					v = p[i] > v ? p[i] : v;
+				return v;
+			}
+		};
+
+		//userdata of num_array<T>, a lua owned buffer follows the header
+		template<typename T>
+		struct num_array_meta
+		{
+			enum { ALIGN = 32 };
+			typedef num_array_kernel<T> kernel;
+
+			static num_array<T>* get(lua_State *L, int index)
+			{
+				return (num_array<T>*)lua_touserdata(L, index);
+			}
+
+			static bool is_num_array(lua_State *L, int index)
+			{
+				if (lua_type(L, index) != LUA_TUSERDATA || lua_getmetatable(L, index) == 0)
+					return false;
+				lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<num_array_meta<T>>::key());
+				bool bIsArray = lua_rawequal(L, -1, -2) != 0;
+				lua_pop(L, 2);
+				return bIsArray;
+			}
+
+			static num_array<T>* check(lua_State *L, int index)
+			{
+				if (is_num_array(L, index) == false)
+				{
+					lua_pushfstring(L, "argument %d must be a num_array", index);
+					lua_error(L);
+				}
+				return get(L, index);
+			}
+
+			//largest element count whose userdata size does not overflow size_t
+			static constexpr size_t max_size()
+			{
+				return (SIZE_MAX - sizeof(num_array<T>) - ALIGN) / sizeof(T);
+			}
+
+			//new lua owned array on top
+			static num_array<T>* create(lua_State *L, size_t nSize)
+			{
+				if (nSize > max_size())
+					luaL_error(L, "num_array size too large: %I", (lua_Integer)nSize);
+				void* pMem = lua_newuserdata(L, sizeof(num_array<T>) + ALIGN + nSize * sizeof(T));
+				uintptr_t nData = ((uintptr_t)pMem + sizeof(num_array<T>) + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1);
+				num_array<T>* pArray = new(pMem) num_array<T>((T*)nData, nSize);
+				memset(pArray->m_data, 0, nSize * sizeof(T));
+				push_meta(L);
+				lua_setmetatable(L, -2);
+				return pArray;
+			}
+
+			static void push_borrowed(lua_State *L, const num_array<T>& val)
+			{
+				new(lua_newuserdata(L, sizeof(num_array<T>))) num_array<T>(val);
+				push_meta(L);
+				lua_setmetatable(L, -2);
+			}
+
+			static size_t _check_index(lua_State *L, num_array<T>* pArray, int index)
+			{
+				lua_Integer n = luaL_checkinteger(L, index);
+				if (n < 1 || (size_t)n > pArray->m_size)
+				{
+					lua_pushfstring(L, "num_array index %d out of range [1, %d]", (int)n, (int)pArray->m_size);
+					lua_error(L);
+				}
+				return (size_t)n - 1;
+			}
+
+			//arr[i] or a method in upvalue 1
+			static int meta_index(lua_State *L)
+			{
+				if (lua_type(L, 2) == LUA_TNUMBER)
+				{
+					num_array<T>* pArray = get(L, 1);
+					int isnum = 0;
+					lua_Integer n = lua_tointegerx(L, 2, &isnum);
+					if (isnum == 0 || n < 1 || (size_t)n > pArray->m_size)
+						return 0;
+					lua_pushnumber(L, pArray->m_data[n - 1]);
+					return 1;
+				}
+				lua_pushvalue(L, 2);
+				lua_rawget(L, lua_upvalueindex(1));
+				return 1;
+			}
+			static int meta_newindex(lua_State *L)
+			{
+				num_array<T>* pArray = get(L, 1);
+				pArray->m_data[_check_index(L, pArray, 2)] = (T)luaL_checknumber(L, 3);
+				return 0;
+			}
+			static int meta_len(lua_State *L)
+			{
+				lua_pushinteger(L, (lua_Integer)get(L, 1)->m_size);
+				return 1;
+			}
+
+			static int method_sum(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				lua_pushnumber(L, kernel::sum(pArray->m_data, pArray->m_size));
+				return 1;
+			}
+			static num_array<T>* _check_same_size(lua_State *L, num_array<T>* pArray, int index)
+			{
+				num_array<T>* pOther = check(L, index);
+				if (pOther->m_size != pArray->m_size)
+				{
+					lua_pushfstring(L, "num_array size mismatch %d ~= %d", (int)pArray->m_size, (int)pOther->m_size);
+					lua_error(L);
+				}
+				return pOther;
+			}
+			static int method_dot(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				num_array<T>* pOther = _check_same_size(L, pArray, 2);
+				lua_pushnumber(L, kernel::dot(pArray->m_data, pOther->m_data, pArray->m_size));
+				return 1;
+			}
+			//self += a * x, return self
+			static int method_axpy(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				T a = (T)luaL_checknumber(L, 2);
+				num_array<T>* pX = _check_same_size(L, pArray, 3);
+				kernel::axpy(pArray->m_data, a, pX->m_data, pArray->m_size);
+				lua_settop(L, 1);
+				return 1;
+			}
+			static int method_scale(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				kernel::scale(pArray->m_data, (T)luaL_checknumber(L, 2), pArray->m_size);
+				lua_settop(L, 1);
+				return 1;
+			}
+			static int method_clamp(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				kernel::clamp(pArray->m_data, (T)luaL_checknumber(L, 2), (T)luaL_checknumber(L, 3), pArray->m_size);
+				lua_settop(L, 1);
+				return 1;
+			}
+			static int method_min(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				if (pArray->m_size == 0)
+					return 0;
+				lua_pushnumber(L, kernel::min(pArray->m_data, pArray->m_size));
+				return 1;
+			}
+			static int method_max(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				if (pArray->m_size == 0)
+					return 0;
+				lua_pushnumber(L, kernel::max(pArray->m_data, pArray->m_size));
+				return 1;
+			}
+			//new array = {self[idx[1]], self[idx[2]], ...}
+			static int method_gather(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				luaL_checktype(L, 2, LUA_TTABLE);
+				size_t nLen = lua_rawlen(L, 2);
+				num_array<T>* pResult = create(L, nLen);
+				for (size_t i = 0; i < nLen; i++)
+				{
+					lua_rawgeti(L, 2, i + 1);
+					size_t nIdx = _check_index(L, pArray, -1);
+					lua_pop(L, 1);
+					pResult->m_data[i] = pArray->m_data[nIdx];
+				}
+				return 1;
+			}
+			//self[idx[i]] = src[i], return self
+			static int method_scatter(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				luaL_checktype(L, 2, LUA_TTABLE);
+				num_array<T>* pSrc = check(L, 3);
+				size_t nLen = lua_rawlen(L, 2);
+				if (nLen > pSrc->m_size)
+				{
+					lua_pushfstring(L, "num_array scatter index count %d > src size %d", (int)nLen, (int)pSrc->m_size);
+					lua_error(L);
+				}
+				for (size_t i = 0; i < nLen; i++)
+				{
+					lua_rawgeti(L, 2, i + 1);
+					size_t nIdx = _check_index(L, pArray, -1);
+					lua_pop(L, 1);
+					pArray->m_data[nIdx] = pSrc->m_data[i];
+				}
+				lua_settop(L, 1);
+				return 1;
+			}
+			static int method_totable(lua_State *L)
+			{
+				num_array<T>* pArray = check(L, 1);
+				lua_createtable(L, (int)pArray->m_size, 0);
+				for (size_t i = 0; i < pArray->m_size; i++)
+				{
+					lua_pushnumber(L, pArray->m_data[i]);
+					lua_rawseti(L, -2, i + 1);
+				}
+				return 1;
+			}
+
+			//name(n) or name({...})
+			static int constructor(lua_State *L)
+			{
+				if (lua_istable(L, 1))
+				{
+					size_t nLen = lua_rawlen(L, 1);
+					num_array<T>* pArray = create(L, nLen);
+					for (size_t i = 0; i < nLen; i++)
+					{
+						lua_rawgeti(L, 1, i + 1);
+						pArray->m_data[i] = (T)lua_tonumber(L, -1);
+						lua_pop(L, 1);
+					}
+				}
+				else
+				{
+					lua_Integer n = luaL_checkinteger(L, 1);
+					if (n > 0 && (lua_Unsigned)n > max_size())
+						luaL_error(L, "num_array size too large: %I", n);
+					create(L, n > 0 ? (size_t)n : 0);
+				}
+				return 1;
+			}
+
+			//registry[class_meta_key<num_array_meta<T>>] = metatable
+			static void push_meta(lua_State *L)
+			{
+				if (lua_rawgetp(L, LUA_REGISTRYINDEX, class_meta_key<num_array_meta<T>>::key()) == LUA_TTABLE)
+					return;
+				lua_pop(L, 1);
+
+				static const luaL_Reg methods[] =
+				{
+					{ "sum", &method_sum },
+					{ "dot", &method_dot },
+					{ "axpy", &method_axpy },
+					{ "scale", &method_scale },
+					{ "clamp", &method_clamp },
+					{ "min", &method_min },
+					{ "max", &method_max },
+					{ "gather", &method_gather },
+					{ "scatter", &method_scatter },
+					{ "totable", &method_totable },
+					{ nullptr, nullptr },
+				};
+				lua_createtable(L, 0, 4);
+				lua_createtable(L, 0, sizeof(methods) / sizeof(methods[0]) - 1);
+				luaL_setfuncs(L, methods, 0);
+				lua_pushcclosure(L, &meta_index, 1);
+				lua_setfield(L, -2, "__index");
+				lua_pushcfunction(L, &meta_newindex);
+				lua_setfield(L, -2, "__newindex");
+				lua_pushcfunction(L, &meta_len);
+				lua_setfield(L, -2, "__len");
+				lua_pushstring(L, "lua_tinker::num_array");
+				lua_setfield(L, -2, "__name");
+
+				lua_pushvalue(L, -1);
+				lua_rawsetp(L, LUA_REGISTRYINDEX, class_meta_key<num_array_meta<T>>::key());
+			}
+		};
+
+		template<typename T>
+		struct _stack_help<num_array<T>>
+		{
+			static constexpr int cover_to_lua_type() { return CLT_USERDATA; }
+
+			static num_array<T> _read(lua_State *L, int index)
+			{
+				return *num_array_meta<T>::check(L, index);
+			}
+			//c++ buffer, lua doesn't hold it
+			static void _push(lua_State *L, const num_array<T>& val)
+			{
+				num_array_meta<T>::push_borrowed(L, val);
+			}
+		};
+
 		template<typename ...Args>
 		struct _stack_help< std::tuple<Args...> >
 		{
@@ -985,8 +2163,70 @@ namespace lua_tinker
 				return _type2lua(L, val);
 			}
 
-		};
-		
+		};
+		
+		//push all elements as multiple results
+		template<typename ...Args>
+		struct _stack_help< multi_return<Args...> >
+		{
+			static constexpr int cover_to_lua_type() { return CLT_NONE; }
+
+			template<std::size_t... index>
+			static void _push_helper(lua_State *L, const multi_return<Args...>& val, std::index_sequence<index...>)
+			{
+				int dummy[] = { 0, (push<Args>(L, std::get<index>(val)), 0)... };
+				(void)dummy;
+			}
+			static void _push(lua_State *L, const multi_return<Args...>& val)
+			{
+				luaL_checkstack(L, sizeof...(Args), "too many results");
+				_push_helper(L, val, std::make_index_sequence<sizeof...(Args)>{});
+			}
+		};
+
+		template<typename T>
+		struct _stack_help< out<T> >
+		{
+			static constexpr int cover_to_lua_type() { return _stack_help<T>::cover_to_lua_type(); }
+
+			static out<T> _read(lua_State *L, int index)
+			{
+				index = lua_absindex(L, index);
+				if (lua_gettop(L) < index)
+					lua_settop(L, index);
+				return out<T>(L, index, lua_isnil(L, index) ? T() : read<T>(L, index));
+			}
+		};
+
+		template<typename T>
+		struct is_out_param : public std::false_type {};
+		template<typename T>
+		struct is_out_param<out<T>> : public std::true_type {};
+
+		template<typename T>
+		struct return_count : public std::integral_constant<int, 1> {};
+		template<typename ...Args>
+		struct return_count<multi_return<Args...>> : public std::integral_constant<int, sizeof...(Args)> {};
+
+		template<int nIdxParams, typename ...Args, std::size_t... index>
+		int _push_out_params(lua_State *L, std::index_sequence<index...>)
+		{
+			int nCount = 0;
+			int dummy[] = { 0, (is_out_param<typename std::decay<Args>::type>::value ? (lua_pushvalue(L, nIdxParams + (int)index), nCount++) : 0)... };
+			(void)dummy;
+			return nCount;
+		}
+
+		//result count of a c function: the return value (multi_return has all its elements), then push the out<T> params
+		template<int nIdxParams, typename RVal, typename ...Args>
+		int push_out_params(lua_State *L)
+		{
+			int nOut = _push_out_params<nIdxParams, Args...>(L, std::make_index_sequence<sizeof...(Args)>{});
+			if (std::is_void<RVal>::value)
+				return nOut > 0 ? nOut : 1;
+			return return_count<RVal>::value + nOut;
+		}
+
 		template<typename RVal, typename ...Args>
 		struct _stack_help< std::function<RVal(Args...)> >
 		{
@@ -1066,6 +2306,41 @@ namespace lua_tinker
 		{
 		};
 
+		template<typename RVal>
+		struct _stack_help< lua_function_unique_ref<RVal> >
+		{
+			static constexpr int cover_to_lua_type() { return CLT_FUNCTION; }
+			//func must be release before lua close.....user_conctrl
+			static lua_function_unique_ref<RVal> _read(lua_State *L, int index)
+			{
+				if (lua_isfunction(L, index) == false)
+				{
+					lua_pushfstring(L, "can't convert argument %d to function", index);
+					lua_error(L);
+				}
+
+				//copy to top
+				lua_pushvalue(L, index);
+				//move top to ref
+				return lua_function_unique_ref<RVal>(L, luaL_ref(L, LUA_REGISTRYINDEX));
+			}
+
+			static void  _push(lua_State *L, const lua_function_unique_ref<RVal>& func)
+			{
+				if (func.m_L != L)
+				{
+					lua_pushfstring(L, "lua_function was not create by the same lua_State");
+					lua_error(L);
+				}
+
+				lua_rawgeti(func.m_L, LUA_REGISTRYINDEX, func.m_regidx);
+			}
+		};
+		template<typename RVal>
+		struct _stack_help<const lua_function_unique_ref<RVal>& > : public _stack_help<lua_function_unique_ref<RVal>>
+		{
+		};
+
 		template<typename T>
 		struct _stack_help< std::shared_ptr<T> >
 		{
@@ -1075,7 +2350,7 @@ namespace lua_tinker
 			{
 				if (!lua_isuserdata(L, index))
 				{
-					lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<T>());
+					lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<T>(L));
 					lua_error(L);
 				}
 
@@ -1083,7 +2358,7 @@ namespace lua_tinker
 				UserDataWapper* pWapper = user2type<UserDataWapper*>(L, index);
 				if (pWapper->isSharedPtr() == false)
 				{
-					lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<T>());
+					lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<T>(L));
 					lua_error(L);
 				}
 
@@ -1091,9 +2366,9 @@ namespace lua_tinker
 				if (pWapper->m_type_idx != get_type_idx<std::shared_ptr<T>>())
 				{
 					//maybe derived to base
-					if (IsInherit(L, pWapper->m_type_idx, get_type_idx<std::shared_ptr<T>>()) == false)
+					if (find_cast(L, pWapper->m_type_idx, get_type_idx<std::shared_ptr<T>>()) == nullptr)
 					{
-						lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<T>());
+						lua_pushfstring(L, "can't convert argument %d to class %s", index, get_class_name<T>(L));
 						lua_error(L);
 					}
 				}
@@ -1111,8 +2386,39 @@ namespace lua_tinker
 
 			}
 			//shared_ptr to lua
+			//reuse the userdata in identity cache, a weak holder can't be reused if it's expired or val is the last owner
+			static bool _push_cached(lua_State *L, const std::shared_ptr<T>& val, bool bNeedOwner)
+			{
+				typedef identity_cache_key<std::shared_ptr<T>> cache_key;
+				if (cache_key::s_enabled.load(std::memory_order_relaxed) == false)
+					return false;
+				UserDataWapper* pWapper = _identity_cache_push(L, cache_key::key(), val.get());
+				if (pWapper == nullptr)
+					return false;
+				if (pWapper->haveOwership() == false)
+				{
+					weakptr2user<T>* pWeakWapper = static_cast<weakptr2user<T>*>(pWapper);
+					if (bNeedOwner || pWeakWapper->m_holder.lock() != val)
+					{
+						lua_pop(L, 1);
+						return false;
+					}
+				}
+				return true;
+			}
+
+			static void _store_cached(lua_State *L, const void* ptr)
+			{
+				typedef identity_cache_key<std::shared_ptr<T>> cache_key;
+				if (cache_key::s_enabled.load(std::memory_order_relaxed))
+					_identity_cache_store(L, cache_key::key(), ptr);
+			}
+
 			static void _push(lua_State *L, std::shared_ptr<T>&& val)
 			{
+				if (val && _push_cached(L, val, val.use_count() == 1))
+					return;
+				const void* ptr = val.get();
 				if (val)
 				{
 					if (val.use_count() == 1)	//last count,if we didn't hold it, it will lost
@@ -1128,8 +2434,10 @@ namespace lua_tinker
 				else
 					lua_pushnil(L);
 
-				push_meta(L, get_class_name<std::shared_ptr<T>>());
+				push_class_meta<std::shared_ptr<T>>(L);
 				lua_setmetatable(L, -2);
+				if (ptr != nullptr)
+					_store_cached(L, ptr);
 			}
 
 			
@@ -1139,6 +2447,8 @@ namespace lua_tinker
 		{
 			static void _push(lua_State *L, const std::shared_ptr<T>& val)
 			{
+				if (val && _stack_help<std::shared_ptr<T>>::_push_cached(L, val, false))
+					return;
 				if (val)
 				{
 					//if (val.use_count() == 1)	//last count,if we didn't hold it, it will lost
@@ -1154,8 +2464,10 @@ namespace lua_tinker
 				else
 					lua_pushnil(L);
 
-				push_meta(L, get_class_name<std::shared_ptr<T>>());
+				push_class_meta<std::shared_ptr<T>>(L);
 				lua_setmetatable(L, -2);
+				if (val)
+					_stack_help<std::shared_ptr<T>>::_store_cached(L, val.get());
 			}
 		};
 
@@ -1196,6 +2508,20 @@ namespace lua_tinker
 		{
 			_stack_help<T>::_push(L, std::forward<T>(ret));
 		}
+	}
+
+	template<typename T>
+	out<T>::~out()
+	{
+		if (m_L)
+		{
+			detail::push<T>(m_L, value);
+			lua_replace(m_L, m_idx);
+		}
+	}
+
+	namespace detail
+	{
 
 
 
@@ -1270,6 +2596,8 @@ namespace lua_tinker
 		//}
 
 		bool CheckSameMetaTable(lua_State* L, int nIndex, const char* tname);
+		//the userdata at nIndex was made by lua_tinker (a UserDataWapper), its metatable's __gc is userdata_destroyer
+		bool is_wapper_userdata(lua_State* L, int nIndex);
 
 
 		template <typename T, bool bConstMemberFunc>
@@ -1299,10 +2627,17 @@ namespace lua_tinker
 #ifdef LUATINKER_USERDATA_CHECK_CONST
 				if (pWapper->is_const() == true && bConstMemberFunc == false)
 				{
-					lua_pushfstring(L, "const class_ptr %s can't invoke non-const member func.", get_class_name<T>());
+					lua_pushfstring(L, "const class_ptr %s can't invoke non-const member func.", get_class_name<T>(L));
 					lua_error(L);
 				}
 #endif
+				if (pWapper->m_type_idx != get_type_idx<T>())
+				{
+					//func come from __parent, adjust this ptr to base
+					const cast_entry* pCast = find_cast(L, pWapper->m_type_idx, get_type_idx<T>());
+					if (pCast != nullptr)
+						return void2type<T*>(pCast->apply(pWapper->m_p));
+				}
 				return void2type<T*>(pWapper->m_p);
 			}
 		}
@@ -1352,7 +2687,7 @@ namespace lua_tinker
 				{
 					push_upval_to_stack(L, lua_gettop(L) - 1, sizeof...(Args), m_nDefaultParamCount, m_nDefaultParamsStart);
 					_invoke_function<RVal>(L, m_func, _read_classptr_from_index1<CT, bConst>(L));
-					return 1;
+					return push_out_params<2, RVal, Args...>(L);
 				}
 				CATCH_LUA_TINKER_INVOKE()
 				{
@@ -1369,7 +2704,7 @@ namespace lua_tinker
 				{
 					push_upval_to_stack(L, lua_gettop(L) - 1, sizeof...(Args));
 					_invoke<RVal>(L, upvalue_<FuncType>(L), _read_classptr_from_index1<CT, bConst>(L));
-					return 1;
+					return push_out_params<2, RVal, Args...>(L);
 				}
 				CATCH_LUA_TINKER_INVOKE()
 				{
@@ -1403,8 +2738,8 @@ namespace lua_tinker
 				{
 					using FuncWarpType = member_functor<bConst, CT, RVal, Args...>;
 					push_upval_to_stack(L, lua_gettop(L)-1, sizeof...(Args));
-					_invoke_function<RVal>(L, upvalue_<FuncWarpType*>(L)->m_pfunc, _read_classptr_from_index1<CT, bConst>(L));
-					return 1;
+					_invoke_function<RVal>(L, upvalue_<FuncWarpType*>(L)->m_func, _read_classptr_from_index1<CT, bConst>(L));
+					return push_out_params<2, RVal, Args...>(L);
 				}
 				CATCH_LUA_TINKER_INVOKE()
 				{
@@ -1470,7 +2805,7 @@ namespace lua_tinker
 				{
 					push_upval_to_stack(L, lua_gettop(L), sizeof...(Args), m_nDefaultParamCount, m_nDefaultParamsStart);
 					_invoke_function<RVal>(L, m_func);
-					return 1;
+					return push_out_params<1, RVal, Args...>(L);
 				}
 				CATCH_LUA_TINKER_INVOKE()
 				{
@@ -1486,7 +2821,7 @@ namespace lua_tinker
 				{
 					push_upval_to_stack(L, lua_gettop(L), sizeof...(Args));
 					_invoke<RVal>(L);
-					return 1;
+					return push_out_params<1, RVal, Args...>(L);
 				}
 				CATCH_LUA_TINKER_INVOKE()
 				{
@@ -1517,7 +2852,7 @@ namespace lua_tinker
 					FuncWarpType* pFuncWarp = upvalue_<FuncWarpType*>(L);
 					push_upval_to_stack(L, lua_gettop(L), sizeof...(Args));
 					_invoke_function<RVal>(L, pFuncWarp->m_func);
-					return 1;
+					return push_out_params<1, RVal, Args...>(L);
 				}
 				CATCH_LUA_TINKER_INVOKE()
 				{
@@ -1540,6 +2875,90 @@ namespace lua_tinker
 			}
 		};
 
+		//compile-time bound functor, the target is a template param so the thunk need not read it from upvalue,
+		//bDefaultArgs=false push the closure without any upvalue
+		template <typename FuncType, FuncType func>
+		struct bound_functor;
+
+		template <typename RVal, typename ... Args, RVal(*func)(Args...)>
+		struct bound_functor<RVal(*)(Args...), func>
+		{
+			using FuncType = RVal(*)(Args...);
+
+			template<bool bDefaultArgs>
+			static int invoke(lua_State *L)
+			{
+				TRY_LUA_TINKER_INVOKE()
+				{
+					if (bDefaultArgs)
+						push_upval_to_stack(L, lua_gettop(L), sizeof...(Args), 1);
+					_invoke<RVal>(L);
+					return push_out_params<1, RVal, Args...>(L);
+				}
+				CATCH_LUA_TINKER_INVOKE()
+				{
+					lua_pushfstring(L, "lua fail to invoke functor");
+					lua_error(L);
+				}
+				return 0;
+			}
+
+			template<typename T>
+			static typename std::enable_if<!std::is_void<T>::value, void>::type _invoke(lua_State *L)
+			{
+				push_rv<RVal>(L, direct_invoke_func<1, RVal, FuncType, Args...>(func, L));
+			}
+
+			template<typename T>
+			static typename std::enable_if<std::is_void<T>::value, void>::type _invoke(lua_State *L)
+			{
+				direct_invoke_func<1, RVal, FuncType, Args...>(func, L);
+			}
+		};
+
+		template <bool bConst, typename CT, typename RVal, typename MemFuncType, MemFuncType func, typename ... Args>
+		struct bound_member_functor
+		{
+			template<bool bDefaultArgs>
+			static int invoke(lua_State *L)
+			{
+				CHECK_CLASS_PTR(CT);
+				TRY_LUA_TINKER_INVOKE()
+				{
+					if (bDefaultArgs)
+						push_upval_to_stack(L, lua_gettop(L) - 1, sizeof...(Args), 1);
+					_invoke<RVal>(L, _read_classptr_from_index1<CT, bConst>(L));
+					return push_out_params<2, RVal, Args...>(L);
+				}
+				CATCH_LUA_TINKER_INVOKE()
+				{
+					lua_pushfstring(L, "lua fail to invoke functor");
+					lua_error(L);
+				}
+				return 0;
+			}
+
+			template<typename T>
+			static typename std::enable_if<!std::is_void<T>::value, void>::type _invoke(lua_State *L, CT* pClassPtr)
+			{
+				push_rv<RVal>(L, direct_invoke_member_func<2, RVal, MemFuncType, CT, Args...>(func, L, pClassPtr));
+			}
+
+			template<typename T>
+			static typename std::enable_if<std::is_void<T>::value, void>::type _invoke(lua_State *L, CT* pClassPtr)
+			{
+				direct_invoke_member_func<2, RVal, MemFuncType, CT, Args...>(func, L, pClassPtr);
+			}
+		};
+
+		template <typename CT, typename RVal, typename ... Args, RVal(CT::*func)(Args...)>
+		struct bound_functor<RVal(CT::*)(Args...), func> : public bound_member_functor<false, CT, RVal, RVal(CT::*)(Args...), func, Args...>
+		{};
+
+		template <typename CT, typename RVal, typename ... Args, RVal(CT::*func)(Args...)const>
+		struct bound_functor<RVal(CT::*)(Args...)const, func> : public bound_member_functor<true, CT, RVal, RVal(CT::*)(Args...)const, func, Args...>
+		{};
+
 		// destroyer
 		template<typename T>
 		int destroyer(lua_State *L)
@@ -1563,6 +2982,13 @@ namespace lua_tinker
 			lua_pushcclosure(L, std::forward<T>(t), upval_num);
 		}
 
+		template<typename FuncType, FuncType func, typename ... DEFAULT_ARGS>
+		void _push_bound_functor(lua_State* L, DEFAULT_ARGS&& ... default_args)
+		{
+			using Functor_Warp = bound_functor<FuncType, func>;
+			_push_functor_invoke(L, 0, &Functor_Warp::template invoke<(sizeof...(DEFAULT_ARGS) > 0)>, std::forward<DEFAULT_ARGS>(default_args)...);
+		}
+
 		// global function
 		template<typename R, typename ...ARGS, typename ... DEFAULT_ARGS>
 		void _push_functor(lua_State* L, R(func)(ARGS...), DEFAULT_ARGS&& ... default_args)
@@ -1689,7 +3115,7 @@ namespace lua_tinker
 		static int _invoke(lua_State *L)
 		{
 			new(lua_newuserdata(L, sizeof(detail::val2user<T>))) detail::val2user<T>(L, detail::class_tag<Args...>());
-			detail::push_meta(L, detail::get_class_name<T>());
+			detail::push_class_meta<T>(L);
 			lua_setmetatable(L, -2);
 
 			return 1;
@@ -1705,6 +3131,22 @@ namespace lua_tinker
 		lua_setglobal(L, name);
 	}
 
+	template<typename Func, Func func, typename ... DefaultArgs>
+	void def(lua_State* L, const char* name, DefaultArgs&& ... default_args)
+	{
+		detail::_push_bound_functor<Func, func>(L, std::forward<DefaultArgs>(default_args)...);
+		lua_setglobal(L, name);
+	}
+
+	template<typename T>
+	void num_array_def(lua_State* L, const char* name)
+	{
+		detail::num_array_meta<T>::push_meta(L);
+		lua_pop(L, 1);
+		lua_pushcfunction(L, &detail::num_array_meta<T>::constructor);
+		lua_setglobal(L, name);
+	}
+
 	// global variable
 	template<typename T>
 	void set(lua_State* L, const char* name, T&& object)
@@ -1730,13 +3172,14 @@ namespace lua_tinker
 	template<typename RVal>
 	RVal dofile(lua_State *L, const char *filename)
 	{
-			lua_pushcclosure(L, get_error_callback(), 0);
+			lua_pushcclosure(L, get_error_callback(L), 0);
 			int errfunc = lua_gettop(L);
 
 			if (luaL_loadfile(L, filename) == 0)
 			{
 				if (lua_pcall(L, 0, detail::pop<RVal>::nresult, errfunc) != LUA_OK)
 				{
+					detail::count_call_error(L);
 					//stack have a nil string from on_error
 					if(detail::pop<RVal>::nresult == 0)
 					{
@@ -1778,13 +3221,14 @@ namespace lua_tinker
 	template<typename RVal>
 	RVal dobuffer(lua_State *L, const char* buff, size_t sz)
 	{
-			lua_pushcclosure(L, get_error_callback(), 0);
+			lua_pushcclosure(L, get_error_callback(L), 0);
 			int errfunc = lua_gettop(L);
 
 			if (luaL_loadbuffer(L, buff, sz, "lua_tinker::dobuffer()") == 0)
 			{
 				if (lua_pcall(L, 0, detail::pop<RVal>::nresult, errfunc) != LUA_OK)
 				{
+					detail::count_call_error(L);
 					//stack have a nil string from on_error
 					if(detail::pop<RVal>::nresult == 0)
 					{
@@ -1822,7 +3266,7 @@ namespace lua_tinker
 	template<typename RVal, typename ...Args>
 	RVal call(lua_State* L, const char* name, Args&&... arg)
 	{
-		lua_pushcclosure(L, get_error_callback(), 0);
+		lua_pushcclosure(L, get_error_callback(L), 0);
 		int errfunc = lua_gettop(L);
 		lua_getglobal(L, name);
 		if (lua_isfunction(L, -1))
@@ -1831,6 +3275,7 @@ namespace lua_tinker
 			
 			if (lua_pcall(L, sizeof...(Args), detail::pop<RVal>::nresult, errfunc) != LUA_OK)
 			{
+				detail::count_call_error(L);
 				//stack have a nil string from on_error
 				if(detail::pop<RVal>::nresult == 0)
 				{
@@ -1975,6 +3420,7 @@ namespace lua_tinker
 			lua_pushstring(L, name);
 			push_meta(L, global_name);
 			lua_rawset(L, -3);
+			on_class_meta_changed(L);
 		}
 	}
 
@@ -2043,11 +3489,31 @@ namespace lua_tinker
 		return pop<T>::apply(L);
 	}
 
+	template<typename T>
+	T namespace_get(lua_State* L, const char* namespace_name, const key& name)
+	{
+		using namespace detail;
+		push_meta(L, namespace_name);
+		stack_obj namespace_meta = stack_obj::get_top(L);
+		if (namespace_meta.is_table())
+		{
+			push(L, name);
+			lua_rawget(L, namespace_meta._stack_pos);
+		}
+		else
+		{
+			lua_pushnil(L);
+		}
+		namespace_meta.remove();
+
+		return pop<T>::apply(L);
+	}
+
 	// class init
 	template<typename T>
 	void class_add(lua_State* L, const char* name, bool bInitShared)
 	{
-		detail::class_name<T>::name(name);
+		detail::set_type_name(L, detail::get_type_idx<T>(), name);
 		lua_createtable(L, 0, 4);
 
 		lua_pushstring(L, "__name");
@@ -2063,15 +3529,25 @@ namespace lua_tinker
 		lua_rawset(L, -3);
 
 		lua_pushstring(L, "__gc");
-		lua_pushcclosure(L, detail::destroyer<detail::UserDataWapper>, 0);
+		lua_pushcclosure(L, detail::userdata_destroyer, 0);
+		lua_rawset(L, -3);
+
+#ifdef LUATINKER_INHERIT_CACHE
+		//lua add a member to class_meta will flush the inherit cache
+		lua_createtable(L, 0, 2);
+		lua_pushstring(L, "__newindex");
+		lua_pushcclosure(L, detail::inherit_cache_newindex, 0);
 		lua_rawset(L, -3);
+		lua_setmetatable(L, -2);
+#endif
 
+		detail::set_class_meta<T>(L);
 		lua_setglobal(L, name);
 
 		if (bInitShared)
 		{
 			std::string strSharedName = (std::string(name) + S_SHARED_PTR_NAME);
-			detail::class_name< std::shared_ptr<T> >::name(strSharedName.c_str());
+			detail::set_type_name(L, detail::get_type_idx< std::shared_ptr<T> >(), strSharedName.c_str());
 			int nReserveSize = 3;
 
 #ifdef _ALLOW_SHAREDPTR_INVOKE
@@ -2085,7 +3561,7 @@ namespace lua_tinker
 			lua_rawset(L, -3);
 
 			lua_pushstring(L, "__gc");
-			lua_pushcclosure(L, detail::destroyer<detail::UserDataWapper>, 0);
+			lua_pushcclosure(L, detail::userdata_destroyer, 0);
 			lua_rawset(L, -3);
 
 #ifdef _ALLOW_SHAREDPTR_INVOKE
@@ -2097,9 +3573,7 @@ namespace lua_tinker
 			lua_pushcclosure(L, detail::meta_set, 0);
 			lua_rawset(L, -3);
 
-			lua_pushstring(L, "__parent");
-			detail::push_meta(L, name);
-			lua_rawset(L, -3);	
+			detail::meta_add_parent(L, lua_gettop(L), name);
 #endif
 			{//register _get_raw_ptr func
 				lua_pushstring(L, "_get_raw_ptr");
@@ -2107,6 +3581,7 @@ namespace lua_tinker
 				lua_rawset(L, -3);
 			}
 
+			detail::set_class_meta< std::shared_ptr<T> >(L);
 			lua_setglobal(L, strSharedName.c_str());
 
 
@@ -2122,60 +3597,43 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
-			stack_obj class_meta = stack_obj::get_top(L);
-#ifndef LUATINKER_MULTI_INHERITANCE
-			lua_pushstring(L, "__parent");
-			push_meta(L, get_class_name<P>());
-			class_meta.rawset();// set class_meta["__parent"] = __parent
-#else
-			stack_obj parent_table = class_meta.rawget("__parent");
-			if (parent_table.is_nil())
-			{
-				parent_table.remove();
-				lua_pushstring(L, "__parent");
-				push_meta(L, get_class_name<P>());
-				class_meta.rawset();// set class_meta["__parent"] = __parent
-			}
-			else
-			{
-				stack_obj parent_table = class_meta.rawget("__multi_parent");
-				if (parent_table.is_nil())
-				{
-					parent_table.remove();
-					lua_pushstring(L, "__multi_parent");
-					lua_createtable(L, 1, 0);
-					parent_table = stack_obj::get_top(L);
-					{
-						push_meta(L, get_class_name<P>());
-						parent_table.rawseti(1);// set __multi_parent[1]=table
-					}
-					class_meta.rawset();// set class_meta["__multi_parent"] = __multi_parent
-				}
-				else
-				{
-					int nLen = parent_table.get_rawlen() + 1;
-					push_meta(L, get_class_name<P>());
-					parent_table.rawseti(nLen); // set __multi_parent[n]=table
-					parent_table.remove();//pop __multi_parent table
-				}
-			}
-#endif
-
+			meta_add_parent(L, lua_gettop(L), get_class_name<P>(L));
 		}
 
-#ifdef LUATINKER_USERDATA_CHECK_TYPEINFO
-		//add inheritance map
-		detail::addInheritMap<T, P>(L);
-#endif
+		on_class_meta_changed(L);
+
+		//add inheritance cast
+		detail::add_cast<T, P>(L);
+
+	}
+
+	template<typename T>
+	void class_identity_cache(lua_State* L, bool bEnable)
+	{
+		if (bEnable)
+		{
+			detail::identity_cache_key<T>::s_enabled = true;
+			detail::identity_cache_key<std::shared_ptr<T>>::s_enabled = true;
+		}
+		detail::_identity_cache_enable(L, detail::identity_cache_key<T>::key(), bEnable);
+		detail::_identity_cache_enable(L, detail::identity_cache_key<std::shared_ptr<T>>::key(), bEnable);
+	}
 
+	template<typename T>
+	void forget(lua_State* L, const T* ptr)
+	{
+		if (detail::identity_cache_key<T>::s_enabled)
+			detail::_identity_cache_forget(L, detail::identity_cache_key<T>::key(), ptr);
+		if (detail::identity_cache_key<std::shared_ptr<T>>::s_enabled)
+			detail::_identity_cache_forget(L, detail::identity_cache_key<std::shared_ptr<T>>::key(), ptr);
 	}
 
 	template<typename T, typename C>
 	void class_inner(lua_State* L, const char* name)
 	{
-		scope_inner(L, detail::get_class_name<T>(), name, detail::get_class_name<C>());
+		scope_inner(L, detail::get_class_name<T>(L), name, detail::get_class_name<C>(L));
 	}
 
 	
@@ -2185,9 +3643,10 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
-			lua_createtable(L, 0, 1);
+			if (lua_getmetatable(L, -1) == 0)
+				lua_createtable(L, 0, 1);
 			lua_pushstring(L, "__call");
 			_push_constructor(L, std::forward<F>(func), std::forward<DefaultArgs>(default_args)...);
 			lua_rawset(L, -3);
@@ -2202,12 +3661,27 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
 			//register functor
 			lua_pushstring(L, name);
 			_push_class_functor(L, std::forward<Func>(func),std::forward<DefaultArgs>(default_args)...);
 			lua_rawset(L, -3);
+			on_class_meta_changed(L);
+		}
+	}
+	template<typename T, typename Func, Func func, typename ... DefaultArgs>
+	void class_def(lua_State* L, const char* name, DefaultArgs&& ... default_args)
+	{
+		using namespace detail;
+		stack_scope_exit scope_exit(L);
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
+		{
+			//register functor
+			lua_pushstring(L, name);
+			_push_bound_functor<Func, func>(L, std::forward<DefaultArgs>(default_args)...);
+			lua_rawset(L, -3);
+			on_class_meta_changed(L);
 		}
 	}
 	template<typename T, typename Func, typename ... DefaultArgs>
@@ -2215,12 +3689,13 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
 			//register functor
 			lua_pushstring(L, name);
 			_push_functor(L, std::forward<Func>(func), std::forward<DefaultArgs>(default_args)...);
 			lua_rawset(L, -3);
+			on_class_meta_changed(L);
 		}
 	}
 
@@ -2350,17 +3825,43 @@ namespace lua_tinker
 		};
 	}
 
+	namespace detail
+	{
+		//call VAR's get/set without virtual dispatch
+		template<typename VAR>
+		void _field_get_thunk(lua_State *L, var_base* pVar)
+		{
+			static_cast<VAR*>(pVar)->VAR::get(L);
+		}
+
+		template<typename VAR>
+		void _field_set_thunk(lua_State *L, var_base* pVar)
+		{
+			static_cast<VAR*>(pVar)->VAR::set(L);
+		}
+
+		//class_meta at top, class_meta[name] = VAR(args...)
+		template<typename VAR, typename ... Args>
+		void _class_add_var(lua_State* L, const char* name, Args&& ... args)
+		{
+			int nMetaIdx = lua_gettop(L);
+			lua_pushstring(L, name);
+			VAR* pVar = new(lua_newuserdata(L, sizeof(VAR))) VAR(std::forward<Args>(args)...);
+			field_table_add(L, nMetaIdx, nMetaIdx + 1, pVar, &_field_get_thunk<VAR>, &_field_set_thunk<VAR>);
+			lua_rawset(L, nMetaIdx);
+		}
+	}
+
 	// Tinker Class Variables
 	template<typename T, typename BASE, typename VAR>
 	void class_mem(lua_State* L, const char* name, VAR BASE::*val)
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
-			lua_pushstring(L, name);
-			new(lua_newuserdata(L, sizeof(mem_var<BASE, VAR>))) mem_var<BASE, VAR>(val);
-			lua_rawset(L, -3);
+			_class_add_var<mem_var<BASE, VAR>>(L, name, val);
+			on_class_meta_changed(L);
 		}
 	}
 
@@ -2370,11 +3871,10 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
-			lua_pushstring(L, name);
-			new(lua_newuserdata(L, sizeof(mem_readonly_var<BASE, VAR>))) mem_readonly_var<BASE, VAR>(val);
-			lua_rawset(L, -3);
+			_class_add_var<mem_readonly_var<BASE, VAR>>(L, name, val);
+			on_class_meta_changed(L);
 		}
 	}
 
@@ -2384,11 +3884,10 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
 		{
-			lua_pushstring(L, name);
-			new(lua_newuserdata(L, sizeof(static_mem_var<VAR>))) static_mem_var<VAR>(val);
-			lua_rawset(L, -3);
+			_class_add_var<static_mem_var<VAR>>(L, name, val);
+			on_class_meta_changed(L);
 		}
 	}
 
@@ -2397,40 +3896,120 @@ namespace lua_tinker
 	{
 		using namespace detail;
 		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
+		{
+			_class_add_var<static_readonly_mem_var<VAR>>(L, name, val);
+			on_class_meta_changed(L);
+		}
+	}
+
+	template<typename T, typename VAR>
+	void class_var_static(lua_State* L, const char* name, VAR&& val)
+	{
+		using namespace detail;
+		stack_scope_exit scope_exit(L);
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
+		{
+			lua_pushstring(L, name);
+			push(L,std::forward<VAR>(val));
+			lua_rawset(L, -3);
+			on_class_meta_changed(L);
+		}
+	}
+
+
+	// Tinker Class Variables
+	template<typename T, typename GET_FUNC, typename SET_FUNC>
+	void class_property(lua_State* L, const char* name, GET_FUNC&& get_func, SET_FUNC&& set_func)
+	{
+		using namespace detail;
+		stack_scope_exit scope_exit(L);
+		if (push_meta(L, get_class_name<T>(L)) == LUA_TTABLE)
+		{
+			_class_add_var<member_property<T, GET_FUNC, SET_FUNC>>(L, name, std::forward<GET_FUNC>(get_func), std::forward<SET_FUNC>(set_func));
+			on_class_meta_changed(L);
+		}
+	};
+
+	// non-owning table handle at an absolute stack index, no heap alloc and no validate when visit,
+	// the caller must keep the table at that slot (don't remove slots below it) while using it
+	struct stack_table
+	{
+		stack_table(lua_State* L, int index) : m_L(L), m_index(lua_absindex(L, index)) {}
+
+		//push a new table with capacity hints
+		static stack_table create(lua_State* L, int narr = 0, int nrec = 0)
+		{
+			lua_createtable(L, narr, nrec);
+			return stack_table(L, lua_gettop(L));
+		}
+
+		template<typename T>
+		void set(const char* key, T&& object)
+		{
+			detail::push(m_L, std::forward<T>(object));
+			lua_setfield(m_L, m_index, key);
+		}
+		template<typename T>
+		void set(int key, T&& object)
+		{
+			detail::push(m_L, std::forward<T>(object));
+			lua_seti(m_L, m_index, key);
+		}
+		template<typename T>
+		void set(const key& k, T&& object)
+		{
+			detail::push(m_L, k);
+			detail::push(m_L, std::forward<T>(object));
+			lua_settable(m_L, m_index);
+		}
+
+		template<typename T>
+		T get(const char* key)
+		{
+			lua_getfield(m_L, m_index, key);
+			return detail::pop<T>::apply(m_L);
+		}
+		template<typename T>
+		T get(int key)
 		{
-			lua_pushstring(L, name);
-			new(lua_newuserdata(L, sizeof(static_readonly_mem_var<VAR>))) static_readonly_mem_var<VAR>(val);
-			lua_rawset(L, -3);
+			lua_geti(m_L, m_index, key);
+			return detail::pop<T>::apply(m_L);
+		}
+		template<typename T>
+		T get(const key& k)
+		{
+			detail::push(m_L, k);
+			lua_gettable(m_L, m_index);
+			return detail::pop<T>::apply(m_L);
 		}
-	}
 
-	template<typename T, typename VAR>
-	void class_var_static(lua_State* L, const char* name, VAR&& val)
-	{
-		using namespace detail;
-		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		size_t len() const
 		{
-			lua_pushstring(L, name);
-			push(L,std::forward<VAR>(val));
-			lua_rawset(L, -3);
+			return (size_t)luaL_len(m_L, m_index);
 		}
-	}
 
+		bool is_table() const { return lua_istable(m_L, m_index); }
 
-	// Tinker Class Variables
-	template<typename T, typename GET_FUNC, typename SET_FUNC>
-	void class_property(lua_State* L, const char* name, GET_FUNC&& get_func, SET_FUNC&& set_func)
-	{
-		using namespace detail;
-		stack_scope_exit scope_exit(L);
-		if (push_meta(L, get_class_name<T>()) == LUA_TTABLE)
+		template<typename T>
+		T convertto()
 		{
-			lua_pushstring(L, name);
-			new(lua_newuserdata(L, sizeof(member_property<T,GET_FUNC, SET_FUNC>))) member_property<T, GET_FUNC, SET_FUNC>(std::forward<GET_FUNC>(get_func), std::forward<SET_FUNC>(set_func));
-			lua_rawset(L, -3);
+			return detail::_readfromtable<T>(m_L, m_index);
+		}
+
+		void for_each(std::function<bool(int key_idx, int value_idx)> func)
+		{
+			detail::table_iterator it(detail::stack_obj(m_L, m_index));
+			while (it.hasNext())
+			{
+				if (func(it.key_idx(), it.value_idx()) == false)
+					return;
+				it.moveNext();
+			}
 		}
+
+		lua_State*	m_L;
+		int			m_index;
 	};
 
 	namespace detail
@@ -2450,36 +4029,27 @@ namespace lua_tinker
 			void set(const char* key, T&& object)
 			{
 				if (validate())
-				{
-					lua_pushstring(m_L, key);
-					detail::push(m_L, std::forward<T>(object));
-					lua_settable(m_L, m_index);
-				}
+					stack_table(m_L, m_index).set(key, std::forward<T>(object));
 			}
 			template<typename T>
 			void set(int key, T&& object)
 			{
 				if (validate())
-				{
-					lua_pushinteger(m_L, key);
-					detail::push(m_L, std::forward<T>(object));
-					lua_settable(m_L, m_index);
-				}
+					stack_table(m_L, m_index).set(key, std::forward<T>(object));
+			}
+			template<typename T>
+			void set(const key& k, T&& object)
+			{
+				if (validate())
+					stack_table(m_L, m_index).set(k, std::forward<T>(object));
 			}
 
 			template<typename T>
 			T get(const char* key)
 			{
 				if (validate())
-				{
-					lua_pushstring(m_L, key);
-					lua_gettable(m_L, m_index);
-				}
-				else
-				{
-					lua_pushnil(m_L);
-				}
-
+					return stack_table(m_L, m_index).get<T>(key);
+				lua_pushnil(m_L);
 				return detail::pop<T>::apply(m_L);
 			}
 
@@ -2487,15 +4057,17 @@ namespace lua_tinker
 			T get(int key)
 			{
 				if (validate())
-				{
-					lua_pushinteger(m_L, key);
-					lua_gettable(m_L, m_index);
-				}
-				else
-				{
-					lua_pushnil(m_L);
-				}
+					return stack_table(m_L, m_index).get<T>(key);
+				lua_pushnil(m_L);
+				return detail::pop<T>::apply(m_L);
+			}
 
+			template<typename T>
+			T get(const key& k)
+			{
+				if (validate())
+					return stack_table(m_L, m_index).get<T>(k);
+				lua_pushnil(m_L);
 				return detail::pop<T>::apply(m_L);
 			}
 
@@ -2525,10 +4097,11 @@ namespace lua_tinker
 	}
 	
 
-	// Table Object Holder
+	// Table Object Holder, own the slot and find the table again if the stack was changed, use stack_table for a lighter handle
 	struct table_onstack
 	{
 		table_onstack(lua_State* L);
+		table_onstack(lua_State* L, int narr, int nrec);	//new table with capacity hints
 		table_onstack(lua_State* L, int index);
 		table_onstack(lua_State* L, const char* name);
 		table_onstack(const table_onstack& input);
@@ -2546,6 +4119,12 @@ namespace lua_tinker
 			m_obj->set(key, std::forward<T>(object));
 		}
 
+		template<typename T>
+		void set(const key& k, T&& object)
+		{
+			m_obj->set(k, std::forward<T>(object));
+		}
+
 		template<typename T>
 		T get(const char* key)
 		{
@@ -2558,6 +4137,12 @@ namespace lua_tinker
 			return m_obj->get<T>(key);
 		}
 
+		template<typename T>
+		T get(const key& k)
+		{
+			return m_obj->get<T>(k);
+		}
+
 		size_t len() const
 		{
 			return m_obj->len();
@@ -2592,11 +4177,12 @@ namespace lua_tinker
 
 	namespace detail
 	{
+		//copyable registry ref, the refcount is kept by lua_State indexed by m_regidx, not a heap int per ref
 		struct lua_ref_base
 		{
 			lua_State* m_L = nullptr;
-			int m_regidx = 0;
-			int* m_pRef = nullptr;
+			int m_regidx = LUA_NOREF;
+			std::vector<int>* m_pRefCount = nullptr;	//owned by lua_State
 
 			void inc_ref();
 			void dec_ref();
@@ -2612,6 +4198,79 @@ namespace lua_tinker
 			lua_ref_base(lua_ref_base&& rht);
 			lua_ref_base& operator=(const lua_ref_base& rht);
 		};
+
+		//move-only registry ref, no refcount
+		struct lua_unique_ref_base
+		{
+			lua_State* m_L = nullptr;
+			int m_regidx = LUA_NOREF;
+
+			bool empty() const { return m_L == nullptr; }
+			void reset();
+
+			lua_unique_ref_base() {}
+			lua_unique_ref_base(lua_State* L, int regidx);
+			~lua_unique_ref_base();
+			lua_unique_ref_base(lua_unique_ref_base&& rht);
+			lua_unique_ref_base& operator=(lua_unique_ref_base&& rht);
+			lua_unique_ref_base(const lua_unique_ref_base&) = delete;
+			lua_unique_ref_base& operator=(const lua_unique_ref_base&) = delete;
+		};
+
+		//call the function in registry[regidx], each arg is pushed as the declared PushArgs (a T& is pushed as a ref),
+		//szName is the global name of a call_handle for the error msg, nullptr for lua_function_ref
+		template<typename RVal, typename ...PushArgs, typename ...Args>
+		RVal _invoke_ref_as(lua_State* L, int regidx, const char* szName, Args&& ... args)
+		{
+			lua_pushcfunction(L, get_error_callback(L));
+			int errfunc = lua_gettop(L);
+
+			if (lua_rawgeti(L, LUA_REGISTRYINDEX, regidx) == LUA_TFUNCTION)
+			{
+				int dummy[] = { 0, (push<PushArgs>(L, std::forward<Args>(args)), 0)... };
+				(void)dummy;
+				if (lua_pcall(L, sizeof...(Args), pop<RVal>::nresult, errfunc) != LUA_OK)
+				{
+					detail::count_call_error(L);
+					//stack have a nil string from on_error
+					if (pop<RVal>::nresult == 0)
+					{
+						//not need it, pop
+						lua_pop(L, 1);
+					}
+					else if (pop<RVal>::nresult > 1)
+					{
+						//push nil to pop result
+						for (int i = 0; i < pop<RVal>::nresult - 1; i++)
+						{
+							lua_pushnil(L);
+						};
+					}
+					else
+					{
+						//==1, leave it for pop resuslt
+					}
+				}
+			}
+			else
+			{
+				lua_pop(L, 1);
+				if (szName != nullptr)
+					print_error(L, "lua_tinker::call_handle attempt to call global `%s' (not a function)", szName);
+				else
+					print_error(L, "lua_tinker::lua_function_ref attempt to call (not a function)");
+			}
+
+			lua_remove(L, errfunc);
+			return pop<RVal>::apply(L);
+		}
+
+		//call the function in registry[regidx], args are pushed by value like push_args
+		template<typename RVal, typename ...Args>
+		RVal _invoke_ref(lua_State* L, int regidx, Args&& ... args)
+		{
+			return _invoke_ref_as<RVal, typename std::decay<Args>::type...>(L, regidx, nullptr, std::forward<Args>(args)...);
+		}
 	}
 	
 	struct table_ref : public detail::lua_ref_base
@@ -2659,6 +4318,84 @@ namespace lua_tinker
 			
 		}
 
+		//visit the table without table_onstack: one lua_rawgeti of the registry slot, the stack is balanced after return
+		template<typename T, typename K>
+		T get(K&& key)
+		{
+			detail::stack_scope_exit scope_exit(m_L);
+			int nTable = _push_table();
+			return _get_field<T, false>(nTable, std::forward<K>(key));
+		}
+		template<typename T, typename K>
+		T rawget(K&& key)
+		{
+			detail::stack_scope_exit scope_exit(m_L);
+			int nTable = _push_table();
+			return _get_field<T, true>(nTable, std::forward<K>(key));
+		}
+		template<typename K, typename T>
+		void set(K&& key, T&& object)
+		{
+			detail::stack_scope_exit scope_exit(m_L);
+			int nTable = _push_table();
+			detail::push(m_L, std::forward<K>(key));
+			detail::push(m_L, std::forward<T>(object));
+			lua_settable(m_L, nTable);
+		}
+		template<typename K, typename T>
+		void rawset(K&& key, T&& object)
+		{
+			detail::stack_scope_exit scope_exit(m_L);
+			int nTable = _push_table();
+			detail::push(m_L, std::forward<K>(key));
+			detail::push(m_L, std::forward<T>(object));
+			lua_rawset(m_L, nTable);
+		}
+		//std::tuple<A,B,C> of t[a], t[b], t[c], get_many<A,B,C>("a", "b", "c")
+		template<typename ...Ts, typename ...Keys>
+		std::tuple<Ts...> get_many(Keys&&... keys)
+		{
+			static_assert(sizeof...(Ts) == sizeof...(Keys), "get_many need a key for each type");
+			detail::stack_scope_exit scope_exit(m_L);
+			int nTable = _push_table();
+			return std::tuple<Ts...>{ _get_field<Ts, false>(nTable, std::forward<Keys>(keys))... };
+		}
+
+	private:
+		//push the table on top, an empty table if the ref is not a table
+		int _push_table()
+		{
+			if (lua_rawgeti(m_L, LUA_REGISTRYINDEX, m_regidx) != LUA_TTABLE)
+			{
+				lua_pop(m_L, 1);
+				print_error(m_L, "lua_tinker::table_ref attempt to visit(not a table)");
+				lua_newtable(m_L);
+			}
+			return lua_gettop(m_L);
+		}
+		template<typename T, bool bRaw, typename K>
+		T _get_field(int nTable, K&& key)
+		{
+			detail::push(m_L, std::forward<K>(key));
+			if (bRaw)
+				lua_rawget(m_L, nTable);
+			else
+				lua_gettable(m_L, nTable);
+			return detail::pop<T>::apply(m_L);
+		}
+	};
+
+	//a lua string interned once and pinned in the registry, push it without hash the c string again,
+	//use it as a table key in hot loops, keep it beside the state it belongs to, e.g. a member of the object owning the lua_State:
+	//m_k_hp = lua_tinker::key(L, "hp"); ... t.get<int>(m_k_hp);
+	//only valid for the lua_State it was made from, so don't keep it in a function static which another state may reach
+	struct key : public detail::lua_ref_base
+	{
+		key() {}
+		key(lua_State* L, const char* str);
+		key(lua_State* L, const char* str, size_t len);
+
+		void push() const { lua_rawgeti(m_L, LUA_REGISTRYINDEX, m_regidx); }
 	};
 
 	template<typename RVal>
@@ -2669,43 +4406,194 @@ namespace lua_tinker
 		template<typename ...Args>
 		RVal operator()(Args&& ... args) const
 		{
-			lua_pushcclosure(m_L, get_error_callback(), 0);
-			int errfunc = lua_gettop(m_L);
+			return detail::_invoke_ref<RVal>(m_L, m_regidx, std::forward<Args>(args)...);
+		}
+	};
+
+	//move-only lua_function_ref, copy it is not allowed so it need not a refcount
+	template<typename RVal>
+	struct lua_function_unique_ref : public detail::lua_unique_ref_base
+	{
+		using lua_unique_ref_base::lua_unique_ref_base;
+
+		template<typename ...Args>
+		RVal operator()(Args&& ... args) const
+		{
+			return detail::_invoke_ref<RVal>(m_L, m_regidx, std::forward<Args>(args)...);
+		}
+	};
+
+	namespace detail
+	{
+		//hold a lua global function in registry, only resolve the name when bind/rebind
+		struct call_handle_base
+		{
+			lua_State* m_L = nullptr;
+			int m_regidx = LUA_NOREF;
+			std::string m_name;
+
+			call_handle_base() {}
+			call_handle_base(lua_State* L, const char* name);
+			~call_handle_base();
+			call_handle_base(call_handle_base&& rht);
+			call_handle_base& operator=(call_handle_base&& rht);
+			call_handle_base(const call_handle_base&) = delete;
+			call_handle_base& operator=(const call_handle_base&) = delete;
+
+			bool bind(lua_State* L, const char* name);
+			//resolve the global name again, call it after the script reloaded. keep the old function if failed
+			bool rebind();
+			void release();
+			bool empty() const { return m_regidx == LUA_NOREF; }
+		};
+	}
+
+	//a prepared call to a lua global function, call_handle<int(int, const ff&)> h(L, "func"); h(1, ff_obj);
+	//must be released before lua_close
+	template<typename Signature>
+	struct call_handle;
+
+	template<typename RVal, typename ...Args>
+	struct call_handle<RVal(Args...)> : public detail::call_handle_base
+	{
+		using call_handle_base::call_handle_base;
+
+		RVal operator()(Args... args) const
+		{
+			//default-constructed or moved-from
+			if (m_L == nullptr)
+				return RVal();
+			if (empty())
+			{
+				print_error(m_L, "lua_tinker::call_handle attempt to call global `%s' (not bound)", m_name.c_str());
+				return RVal();
+			}
+			//push as the declared args type, so a T& arg is pushed as a ref
+			return detail::_invoke_ref_as<RVal, Args...>(m_L, m_regidx, m_name.c_str(), std::forward<Args>(args)...);
+		}
+	};
+
+	//a failed item of call_batch
+	struct call_batch_error
+	{
+		size_t m_index;
+		std::string m_msg;
+	};
+
+	namespace detail
+	{
+		//message handler of call_batch, return the error msg with traceback
+		int _call_batch_error_handler(lua_State* L);
+
+		template<typename T>
+		typename std::enable_if<!is_tuple<typename std::decay<T>::type>::value, int>::type _push_batch_item(lua_State* L, T&& item)
+		{
+			push(L, std::forward<T>(item));
+			return 1;
+		}
+
+		template<typename Tup, std::size_t... index>
+		void _push_batch_tuple(lua_State* L, const Tup& tup, std::index_sequence<index...>)
+		{
+			int dummy[] = { 0, (push(L, std::get<index>(tup)), 0)... };
+			(void)dummy;
+		}
+
+		template<typename T>
+		typename std::enable_if<is_tuple<typename std::decay<T>::type>::value, int>::type _push_batch_item(lua_State* L, T&& item)
+		{
+			constexpr const size_t nSize = std::tuple_size<typename std::decay<T>::type>::value;
+			_push_batch_tuple(L, item, std::make_index_sequence<nSize>{});
+			return (int)nSize;
+		}
+
+		template<typename RVal, typename InputIt, typename OutputIt>
+		struct call_batch_context
+		{
+			InputIt m_it;
+			InputIt m_last;
+			OutputIt m_out;
+			size_t m_index;
 
-			if (lua_rawgeti(m_L, LUA_REGISTRYINDEX, m_regidx) == LUA_TFUNCTION)
+			//run in lua_pcall, arg1 = context, arg2 = lua function; stop at the first failed item
+			static int run(lua_State* L)
 			{
-				detail::push_args(m_L, std::forward<Args>(args)...);
-				if (lua_pcall(m_L, sizeof...(Args), detail::pop<RVal>::nresult, errfunc) != 0)
+				call_batch_context* pCtx = (call_batch_context*)lua_touserdata(L, 1);
+				for (; pCtx->m_it != pCtx->m_last; ++pCtx->m_it, ++pCtx->m_index)
 				{
-					//stack have a nil string from on_error
-					if(detail::pop<RVal>::nresult == 0)
-					{
-						//not need it, pop
-						lua_pop(m_L,1);
-					}
-					else if(detail::pop<RVal>::nresult > 1)
-					{
-						//push nil to pop result
-						for(int i = 0; i < detail::pop<RVal>::nresult-1; i++)
-						{
-							lua_pushnil(m_L);
-						};
-					}
-					else
-					{
-						//==1, leave it for pop resuslt
-					}
+					lua_pushvalue(L, 2);
+					int nArgs = _push_batch_item(L, *pCtx->m_it);
+					lua_call(L, nArgs, pop<RVal>::nresult);
+					pCtx->template write<RVal>(L);
 				}
+				return 0;
 			}
-			else
+
+			template<typename T>
+			typename std::enable_if<!std::is_void<T>::value, void>::type write(lua_State* L)
+			{
+				*m_out = pop<RVal>::apply(L);
+				++m_out;
+			}
+			template<typename T>
+			typename std::enable_if<std::is_void<T>::value, void>::type write(lua_State* L)
+			{
+			}
+
+			//a failed item write a default value, if it can
+			template<typename T>
+			typename std::enable_if<!std::is_void<T>::value && std::is_default_constructible<typename std::decay<T>::type>::value, void>::type write_failed()
+			{
+				*m_out = typename std::decay<T>::type();
+				++m_out;
+			}
+			template<typename T>
+			typename std::enable_if<std::is_void<T>::value || !std::is_default_constructible<typename std::decay<T>::type>::value, void>::type write_failed()
 			{
-				print_error(m_L, "lua_tinker::lua_function_ref attempt to call (not a function)");
 			}
+		};
+	}
+
+	//call the lua function held by func (lua_function_ref/lua_function_unique_ref/call_handle) once for every item in [first, last),
+	//an item is a std::tuple of args or a single arg. the function and message handler are pushed once, items run back to back
+	//under one lua_pcall, a failed item only restart the pcall from the next item. results are written to out (a default value
+	//for a failed item, out is not used when RVal is void), errors are appended to pErrors or passed to the state's error callback
+	//if pErrors is null, every failed item count in state_stats.
+	//return the count of failed items
+	template<typename RVal, typename Handle, typename InputIt, typename OutputIt>
+	size_t call_batch(const Handle& func, InputIt first, InputIt last, OutputIt out, std::vector<call_batch_error>* pErrors = nullptr)
+	{
+		typedef detail::call_batch_context<RVal, InputIt, OutputIt> context_t;
+		lua_State* L = func.m_L;
+		size_t nFailed = 0;
+		context_t ctx{ first, last, out, 0 };
+		//without pErrors a failed item goes to the state's error callback like the other calls
+		lua_pushcfunction(L, pErrors != nullptr ? &detail::_call_batch_error_handler : get_error_callback(L));
+		int errfunc = lua_gettop(L);
+		while (ctx.m_it != ctx.m_last)
+		{
+			lua_pushcfunction(L, &context_t::run);
+			lua_pushlightuserdata(L, &ctx);
+			lua_rawgeti(L, LUA_REGISTRYINDEX, func.m_regidx);
+			if (lua_pcall(L, 2, 0, errfunc) == LUA_OK)
+				break;
 
-			lua_remove(m_L, errfunc);
-			return detail::pop<RVal>::apply(m_L);
+			//ctx.m_it is the failed item
+			detail::count_call_error(L);
+			if (pErrors != nullptr)
+			{
+				const char* pMsg = lua_tostring(L, -1);
+				pErrors->push_back(call_batch_error{ ctx.m_index, pMsg != nullptr ? pMsg : "" });
+			}
+			lua_pop(L, 1);
+			ctx.template write_failed<RVal>();
+			++ctx.m_it;
+			++ctx.m_index;
+			++nFailed;
 		}
-	};
+		lua_remove(L, errfunc);
+		return nFailed;
+	}
 
 } // namespace lua_tinker
 
@@ -2754,6 +4642,21 @@ namespace lua_tinker
 
 
 
+		//type idx of a userdata args for overload resolution, 0 means accept any userdata
+		template<typename T>
+		struct overload_userdata_type
+		{
+			static uint32_t get()
+			{
+				return _stack_help<T>::cover_to_lua_type() == CLT_USERDATA && std::is_same<void, base_type<T>>::value == false ? (uint32_t)get_type_idx<base_type<T>>() : 0;
+			}
+		};
+		template<>
+		struct overload_userdata_type<lua_value*>
+		{
+			static uint32_t get() { return 0; }
+		};
+
 		void _set_signature_bit(unsigned long long& sig, size_t idx, unsigned char c);
 		unsigned char _get_signature_bit(const unsigned long long& sig, size_t idx);
 
@@ -2762,9 +4665,19 @@ namespace lua_tinker
 	struct args_type_overload_functor_base
 	{
 		typedef std::shared_ptr<detail::functor_base> functor_base_ptr;
-		typedef std::multimap<unsigned long long, functor_base_ptr > overload_funcmap_t;
-		typedef std::map<size_t, overload_funcmap_t > overload_funcmap_by_argsnum_t;
-		overload_funcmap_by_argsnum_t m_overload_funcmap;
+		static constexpr const size_t MAX_ARGS_NUM = 16;
+		//type idx of every userdata args, 0 means not a userdata or accept any userdata
+		typedef std::array<uint32_t, MAX_ARGS_NUM> userdata_types_t;
+		struct overload_entry
+		{
+			unsigned long long m_sig;
+			detail::functor_base* m_func;
+			userdata_types_t m_userdata_types;
+		};
+		//sorted by m_sig, indexed by args num
+		typedef std::vector<overload_entry> overload_entrys_t;
+		overload_entrys_t m_overload_entrys[MAX_ARGS_NUM + 1];
+		std::vector<functor_base_ptr> m_functors;
 		int m_nParamsOffset = 0;
 
 		args_type_overload_functor_base()
@@ -2773,20 +4686,26 @@ namespace lua_tinker
 
 		virtual ~args_type_overload_functor_base()
 		{
-			m_overload_funcmap.clear();
 		}
 		args_type_overload_functor_base(args_type_overload_functor_base&& rht)
-			:m_nParamsOffset(rht.m_nParamsOffset)
-			, m_overload_funcmap(rht.m_overload_funcmap)
+			:m_functors(std::move(rht.m_functors))
+			, m_nParamsOffset(rht.m_nParamsOffset)
+		{
+			for (size_t i = 0; i <= MAX_ARGS_NUM; i++)
+				m_overload_entrys[i] = std::move(rht.m_overload_entrys[i]);
+		}
+
+		template<typename ... Args>
+		static userdata_types_t make_userdata_types()
 		{
-			rht.m_overload_funcmap.clear();
+			return userdata_types_t{ { detail::overload_userdata_type<Args>::get()... } };
 		}
 
-		void insert(size_t args_num, size_t default_args_num, unsigned long long sig, functor_base_ptr&& ptr)
+		void insert(size_t args_num, size_t default_args_num, unsigned long long sig, const userdata_types_t& userdata_types, functor_base_ptr&& ptr)
 		{
 			for (size_t i = 0; i <= default_args_num && i <= args_num; i++)
 			{
-				auto& refMap = m_overload_funcmap[args_num - i];
+				auto& refEntrys = m_overload_entrys[args_num - i];
 				static const unsigned long long mask[] =
 				{
 					0,
@@ -2807,31 +4726,91 @@ namespace lua_tinker
 					0xFFFFFFFFFFFFFFF,
 					0xFFFFFFFFFFFFFFFF,
 				};
-				long long new_sig = sig & mask[args_num - i];
+				overload_entry entry{ sig & mask[args_num - i], ptr.get(), userdata_types };
+				auto it = std::upper_bound(refEntrys.begin(), refEntrys.end(), entry.m_sig, [](unsigned long long sig, const overload_entry& ref) { return sig < ref.m_sig; });
+				refEntrys.insert(it, entry);
+			}
+			m_functors.emplace_back(std::move(ptr));
+		}
 
-				refMap.emplace(new_sig,ptr);
+		//more than one overload have the same signature, use the class of userdata args to choose one,
+		//exact class is better than a base class, return nullptr if no one or more than one are the best
+		const overload_entry* select_by_userdata_type(lua_State* L, const overload_entry* pBegin, const overload_entry* pEnd, int nParamsCount, unsigned long long sig)
+		{
+			const overload_entry* pBest = nullptr;
+			int nBestScore = -1;
+			bool bAmbiguous = false;
+			for (const overload_entry* pEntry = pBegin; pEntry != pEnd; ++pEntry)
+			{
+				int nScore = 0;
+				for (int i = 0; i < nParamsCount && nScore >= 0; i++)
+				{
+					uint32_t nNeedType = pEntry->m_userdata_types[i];
+					if (nNeedType == 0 || detail::_get_signature_bit(sig, i) != detail::CLT_USERDATA)
+						continue;
+					//view/num_array/foreign userdata has no UserDataWapper header
+					if (detail::is_wapper_userdata(L, i + m_nParamsOffset + 1) == false)
+					{
+						nScore = -1;
+						continue;
+					}
+					const detail::UserDataWapper* pWapper = (const detail::UserDataWapper*)lua_touserdata(L, i + m_nParamsOffset + 1);
+					if (pWapper->m_type_idx == nNeedType)
+						nScore += 2;
+					else if (detail::find_cast(L, pWapper->m_type_idx, nNeedType) != nullptr)
+						nScore += 1;
+					else
+						nScore = -1;
+				}
+				if (nScore > nBestScore)
+				{
+					pBest = pEntry;
+					nBestScore = nScore;
+					bAmbiguous = false;
+				}
+				else if (nScore == nBestScore)
+				{
+					bAmbiguous = true;
+				}
 			}
+			if (nBestScore < 0 || bAmbiguous)
+				return nullptr;
+			return pBest;
 		}
 
 		int apply(lua_State* L)
 		{
 			unsigned long long sig = 0;
 			int nParamsCount = lua_gettop(L) - m_nParamsOffset;
+			if (nParamsCount < 0 || nParamsCount > (int)MAX_ARGS_NUM)
+			{
+				lua_pushfstring(L, "function overload can't find %d args resolution ", nParamsCount);
+				lua_error(L);
+				return -1;
+			}
 			for (int i = 0; i < nParamsCount; i++)
 			{
 				int nType = detail::LType2ParamsType(L, i + m_nParamsOffset + 1);
 				detail::_set_signature_bit(sig, i, nType);
 			}
-			auto& refMap = m_overload_funcmap[nParamsCount];
-			auto itFind = refMap.equal_range(sig);
-			if(itFind.first == refMap.end())
+			const overload_entrys_t& refEntrys = m_overload_entrys[nParamsCount];
+			const overload_entry* pEnd = refEntrys.data() + refEntrys.size();
+			const overload_entry* pFind = std::lower_bound(refEntrys.data(), pEnd, sig, [](const overload_entry& ref, unsigned long long sig) { return ref.m_sig < sig; });
+			if (pFind == pEnd || pFind->m_sig != sig)
 			{
 				//signature mismatch
 				lua_pushfstring(L, "function overload can't find %d args resolution ", nParamsCount);
 				lua_error(L);
 				return -1;
 			}
-			else if (std::next(itFind.first) != itFind.second)
+			if (pFind + 1 != pEnd && pFind[1].m_sig == sig)
+			{
+				const overload_entry* pSameEnd = pFind + 2;
+				while (pSameEnd != pEnd && pSameEnd->m_sig == sig)
+					++pSameEnd;
+				pFind = select_by_userdata_type(L, pFind, pSameEnd, nParamsCount, sig);
+			}
+			if (pFind == nullptr)
 			{
 				//signature mismatch
 				std::string strSig;
@@ -2847,11 +4826,7 @@ namespace lua_tinker
 				lua_error(L);
 				return -1;
 			}
-			else
-			{
-				return itFind.first->second->apply(L);
-				
-			}
+			return pFind->m_func->apply(L);
 		}
 
 		static int invoke_function(lua_State* L)
@@ -2882,7 +4857,7 @@ namespace lua_tinker
 		void push_to_map_help(detail::functor<RVal, Args...>* ptr)
 		{
 			constexpr long long sig = detail::function_signature<RVal(Args...)>::m_sig;
-			insert(sizeof...(Args), ptr->getDefaultArgsNum(), sig, functor_base_ptr(ptr));
+			insert(sizeof...(Args), ptr->getDefaultArgsNum(), sig, make_userdata_types<Args...>(), functor_base_ptr(ptr));
 		}
 	};
 	struct args_type_overload_member_functor : public args_type_overload_functor_base
@@ -2907,7 +4882,7 @@ namespace lua_tinker
 		void push_to_map_help(detail::member_functor<bConst, CT, RVal, Args...>* ptr)
 		{
 			constexpr long long sig = detail::function_signature<RVal(CT::*)(Args...)>::m_sig;
-			insert(sizeof...(Args), ptr->getDefaultArgsNum(), sig, functor_base_ptr(ptr));
+			insert(sizeof...(Args), ptr->getDefaultArgsNum(), sig, make_userdata_types<Args...>(), functor_base_ptr(ptr));
 		}
 	};
 
@@ -2935,7 +4910,7 @@ namespace lua_tinker
 		void push_to_map_help(constructor<T, Args...>* ptr)
 		{
 			constexpr const long long sig = detail::function_signature<void(Args...)>::m_sig;
-			insert(sizeof...(Args), ptr->getDefaultArgsNum(), sig, functor_base_ptr(ptr));
+			insert(sizeof...(Args), ptr->getDefaultArgsNum(), sig, make_userdata_types<Args...>(), functor_base_ptr(ptr));
 		}
 
 	};
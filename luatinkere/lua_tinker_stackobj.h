@@ -156,6 +156,17 @@ namespace lua_tinker
 				return stack_obj(L, 0);
 			}
 
+			//light userdata key, no string hash
+			stack_obj rawgetp(const void* p) const
+			{
+				if (is_vaild())
+				{
+					lua_rawgetp(L, _stack_pos, p);
+					return get_top(L);
+				}
+				return stack_obj(L, 0);
+			}
+
 			stack_obj rawgeti(int n) const
 			{
 				if (is_vaild())
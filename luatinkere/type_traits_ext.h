@@ -179,6 +179,22 @@ struct is_associative_container
 { };
 
 
+//////////////////////////////////////////////////////////////////////////////////
+//
+// has_reserve
+//
+
+template <typename T>
+class has_reserve
+{
+	template <class C> static std::true_type check(decltype(std::declval<C&>().reserve(0))*);
+	template <class C> static std::false_type check(...);
+public:
+
+	enum { value = decltype(check<T>(nullptr))::value };
+};
+
+
 //////////////////////////////////////////////////////////////////////////////////
 //
 // is_tuple
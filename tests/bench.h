@@ -0,0 +1,33 @@
+#pragma once
+
+#include<chrono>
+#include<functional>
+#include<map>
+#include<string>
+#include<stdio.h>
+
+//run by "test_runner bench"
+extern std::map<std::string, std::function<void()> > g_bench_func_set;
+
+//invoke func nCount times, print ops per second
+template<typename Func>
+void bench_run(const char* name, size_t nCount, Func&& func)
+{
+	auto tBegin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < nCount; i++)
+	{
+		func();
+	}
+	std::chrono::duration<double> tCost = std::chrono::steady_clock::now() - tBegin;
+	printf("%-48s %14.0f ops/s\n", name, nCount / tCost.count());
+}
+
+//func run nCount ops itself (like a loop in lua), print ops per second
+template<typename Func>
+void bench_run_batch(const char* name, size_t nCount, Func&& func)
+{
+	auto tBegin = std::chrono::steady_clock::now();
+	func(nCount);
+	std::chrono::duration<double> tCost = std::chrono::steady_clock::now() - tBegin;
+	printf("%-48s %14.0f ops/s\n", name, nCount / tCost.count());
+}
@@ -0,0 +1,32 @@
+#include "lua_tinker.h"
+#include "test.h"
+#include "bench.h"
+
+void bench_class_member(lua_State* L)
+{
+	g_bench_func_set["bench_class_member"] = [L]()
+	{
+		std::string luabuf =
+			R"(function bench_class_member_get(n)
+					local Intop = IntOpTest(1);
+					local sum = 0;
+					for i = 1, n do sum = sum + Intop.m_n; end
+				end
+				function bench_class_member_set(n)
+					local Intop = IntOpTest(1);
+					for i = 1, n do Intop.m_n = i; end
+				end
+				function bench_class_member_property(n)
+					local pFF = get_gff_ptr();
+					local sum = 0;
+					for i = 1, n do sum = sum + pFF.m_prop; end
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+
+		const size_t nCount = 1000000;
+		bench_run_batch("class_member get IntOpTest.m_n", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_class_member_get", n); });
+		bench_run_batch("class_member set IntOpTest.m_n", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_class_member_set", n); });
+		bench_run_batch("class_member property ff.m_prop", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_class_member_property", n); });
+	};
+}
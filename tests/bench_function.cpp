@@ -0,0 +1,142 @@
+#include "lua_tinker.h"
+#include "test.h"
+#include "bench.h"
+
+static int bench_function_add(int a, int b)
+{
+	return a + b;
+}
+
+static size_t bench_function_strlen(const std::string& str)
+{
+	return str.size();
+}
+
+static size_t bench_function_strlen_view(lua_tinker::string_view str)
+{
+	return str.size();
+}
+
+static std::tuple<int, float, bool> bench_function_query_tuple(int n)
+{
+	return std::make_tuple(n, 0.5f, true);
+}
+
+static lua_tinker::multi_return<int, float, bool> bench_function_query_multi(int n)
+{
+	return { n, 0.5f, true };
+}
+
+void bench_function(lua_State* L)
+{
+	g_bench_func_set["bench_function"] = [L]()
+	{
+		lua_tinker::def(L, "bench_function_add", &bench_function_add);
+		lua_tinker::def<LUATINKER_BIND(&bench_function_add)>(L, "bench_function_add_bound");
+		lua_tinker::class_def<ff, LUATINKER_BIND(&ff::test_base_callfn)>(L, "test_base_callfn_bound");
+		lua_tinker::def(L, "bench_function_strlen", &bench_function_strlen);
+		lua_tinker::def(L, "bench_function_query_tuple", &bench_function_query_tuple);
+		lua_tinker::def(L, "bench_function_query_multi", &bench_function_query_multi);
+		lua_tinker::def(L, "bench_function_strlen_view", &bench_function_strlen_view);
+		std::string luabuf =
+			R"(function bench_function_global(n)
+					local sum = 0;
+					for i = 1, n do sum = bench_function_add(sum, i); end
+				end
+				function bench_function_global_bound(n)
+					local sum = 0;
+					for i = 1, n do sum = bench_function_add_bound(sum, i); end
+				end
+				function bench_function_strlen_loop(n)
+					local str = string.rep("log message ", 8);
+					for i = 1, n do bench_function_strlen(str); end
+				end
+				function bench_function_strlen_view_loop(n)
+					local str = string.rep("log message ", 8);
+					for i = 1, n do bench_function_strlen_view(str); end
+				end
+				function bench_function_query_tuple_loop(n)
+					local sum = 0;
+					for i = 1, n do local t = bench_function_query_tuple(i); sum = sum + t[1]; end
+				end
+				function bench_function_query_multi_loop(n)
+					local sum = 0;
+					for i = 1, n do local a, b, c = bench_function_query_multi(i); sum = sum + a; end
+				end
+				function bench_function_overload(n)
+					local sum = 0;
+					for i = 1, n do sum = test_overload(sum, 1.0); end
+				end
+				function bench_function_lua_add(a, b)
+					return a + b;
+				end
+				function bench_function_on_update(entity, dt)
+					return entity;
+				end
+				function bench_function_member(n)
+					local pFF = get_gff_ptr();
+					for i = 1, n do pFF:test_base_callfn(i); end
+				end
+				function bench_function_member_bound(n)
+					local pFF = get_gff_ptr();
+					for i = 1, n do pFF:test_base_callfn_bound(i); end
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+
+		const size_t nCount = 1000000;
+		bench_run_batch("function def add(a,b)", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_global", n); });
+		bench_run_batch("function def bound add(a,b)", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_global_bound", n); });
+		bench_run_batch("function def strlen(const std::string&)", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_strlen_loop", n); });
+		bench_run_batch("function def strlen(string_view)", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_strlen_view_loop", n); });
+		bench_run_batch("function return tuple<int,float,bool>", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_query_tuple_loop", n); });
+		bench_run_batch("function return multi_return<int,float,bool>", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_query_multi_loop", n); });
+		bench_run_batch("function overload test_overload(n,d)", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_overload", n); });
+		bench_run_batch("function class_def ff:test_base_callfn()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_member", n); });
+		bench_run_batch("function class_def bound ff:test_base_callfn()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_function_member_bound", n); });
+
+		//c++ call lua
+		bench_run("function call<int>() lua_add(a,b)", nCount, [L]() { lua_tinker::call<int>(L, "bench_function_lua_add", 1, 2); });
+		lua_tinker::call_handle<int(int, int)> handle(L, "bench_function_lua_add");
+		bench_run("function call_handle lua_add(a,b)", nCount, [&handle]() { handle(1, 2); });
+
+		//lua callback hold in c++
+		lua_tinker::lua_function_ref<int> func_ref = lua_tinker::get<lua_tinker::lua_function_ref<int>>(L, "bench_function_lua_add");
+		bench_run("function lua_function_ref<int> invoke", nCount, [&func_ref]() { func_ref(1, 2); });
+		//batch of on_update(entity, dt)
+		{
+			std::vector<std::tuple<int, double>> vecArgs;
+			for (int i = 0; i < 5000; i++)
+				vecArgs.emplace_back(i, 0.016);
+			std::vector<int> vecResult(vecArgs.size());
+			lua_tinker::lua_function_ref<int> update_ref = lua_tinker::get<lua_tinker::lua_function_ref<int>>(L, "bench_function_on_update");
+			bench_run_batch("function lua_function_ref on_update() x5000", nCount, [&](size_t n)
+			{
+				for (size_t i = 0; i < n; i += vecArgs.size())
+				{
+					for (size_t j = 0; j < vecArgs.size(); j++)
+						vecResult[j] = update_ref(std::get<0>(vecArgs[j]), std::get<1>(vecArgs[j]));
+				}
+			});
+			bench_run_batch("function call_batch on_update() x5000", nCount, [&](size_t n)
+			{
+				for (size_t i = 0; i < n; i += vecArgs.size())
+					lua_tinker::call_batch<int>(update_ref, vecArgs.begin(), vecArgs.end(), vecResult.begin());
+			});
+		}
+		bench_run("function lua_function_ref<int> get+copy", nCount, [L]()
+		{
+			lua_tinker::lua_function_ref<int> ref = lua_tinker::get<lua_tinker::lua_function_ref<int>>(L, "bench_function_lua_add");
+			lua_tinker::lua_function_ref<int> ref_copy(ref);
+		});
+		bench_run("function lua_function_unique_ref<int> get", nCount, [L]()
+		{
+			lua_tinker::lua_function_unique_ref<int> ref = lua_tinker::get<lua_tinker::lua_function_unique_ref<int>>(L, "bench_function_lua_add");
+		});
+		bench_run("function std::function<int(int,int)> get+copy", nCount, [L]()
+		{
+			std::function<int(int, int)> func = lua_tinker::get<std::function<int(int, int)>>(L, "bench_function_lua_add");
+			std::function<int(int, int)> func_copy(func);
+		});
+	};
+}
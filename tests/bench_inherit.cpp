@@ -0,0 +1,43 @@
+#include "lua_tinker.h"
+#include "test.h"
+#include "bench.h"
+
+void bench_inherit(lua_State* L)
+{
+	g_bench_func_set["bench_inherit"] = [L]()
+	{
+		std::string luabuf =
+			R"(function bench_inherit_self(n)
+					local pFF = get_gff_ptr();
+					for i = 1, n do pFF:getVal(); end
+				end
+				function bench_inherit_base(n)
+					local pFF = get_gff_ptr();
+					for i = 1, n do pFF:test_base_callfn(i); end
+				end
+				function bench_inherit_multi_base(n)
+					local pFF = get_gff_ptr();
+					for i = 1, n do pFF:test_other_callfn(i); end
+				end
+				function bench_method_self(n)
+					local pObj = g_bench_ff_other_base;
+					for i = 1, n do pObj:test_other_callfn(i); end
+				end
+				function bench_method_parent(n)
+					local pObj = g_bench_ff_other_baseB;
+					for i = 1, n do pObj:test_other_callfn(i); end
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		//classes without member var
+		lua_tinker::set(L, "g_bench_ff_other_base", static_cast<ff_other_base*>(get_gff_ptr()));
+		lua_tinker::set(L, "g_bench_ff_other_baseB", static_cast<ff_other_baseB*>(get_gff_ptr()));
+
+		const size_t nCount = 1000000;
+		bench_run_batch("inherit ff:getVal()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_inherit_self", n); });
+		bench_run_batch("inherit ff_base:test_base_callfn()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_inherit_base", n); });
+		bench_run_batch("inherit ff_other_base:test_other_callfn()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_inherit_multi_base", n); });
+		bench_run_batch("method ff_other_base:test_other_callfn()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_method_self", n); });
+		bench_run_batch("method ff_other_baseB:test_other_callfn()", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_method_parent", n); });
+	};
+}
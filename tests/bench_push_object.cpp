@@ -0,0 +1,101 @@
+#include "lua_tinker.h"
+#include "test.h"
+#include "bench.h"
+
+//lua memory per object, keep nCount objects alive in a table
+template<typename Func>
+void bench_memory(lua_State* L, const char* name, size_t nCount, Func&& func)
+{
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	lua_createtable(L, (int)nCount, 0);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	size_t nBegin = (size_t)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+	for (size_t i = 1; i <= nCount; i++)
+	{
+		func();
+		lua_rawseti(L, -2, (lua_Integer)i);
+	}
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	size_t nEnd = (size_t)lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+	lua_pop(L, 1);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	printf("%-48s %14.1f bytes/obj\n", name, double(nEnd - nBegin) / nCount);
+}
+
+void bench_push_object(lua_State* L)
+{
+	g_bench_func_set["bench_push_object"] = [L]()
+	{
+		const size_t nCount = 1000000;
+		ff* pFF = get_gff_ptr();
+		bench_run("push_object ff*", nCount, [L, pFF]()
+		{
+			lua_tinker::detail::push(L, pFF);
+			lua_pop(L, 1);
+		});
+		lua_gc(L, LUA_GCCOLLECT, 0);
+
+		lua_tinker::class_identity_cache<ff>(L);
+		bench_run("push_object ff* (identity cache)", nCount, [L, pFF]()
+		{
+			lua_tinker::detail::push(L, pFF);
+			lua_pop(L, 1);
+		});
+		lua_tinker::class_identity_cache<ff>(L, false);
+		lua_gc(L, LUA_GCCOLLECT, 0);
+
+		ff& refFF = *pFF;
+		bench_run("push_object ff&", nCount, [L, &refFF]()
+		{
+			lua_tinker::detail::push<ff&>(L, refFF);
+			lua_pop(L, 1);
+		});
+		lua_gc(L, LUA_GCCOLLECT, 0);
+
+		std::shared_ptr<ff> ptrFF = make_ff();
+		bench_run("push_object std::shared_ptr<ff>", nCount, [L, &ptrFF]()
+		{
+			lua_tinker::detail::push(L, ptrFF);
+			lua_pop(L, 1);
+		});
+		lua_gc(L, LUA_GCCOLLECT, 0);
+
+		bench_run("push_object IntOpTest(val)", nCount, [L]()
+		{
+			lua_tinker::detail::push(L, IntOpTest(1));
+			lua_pop(L, 1);
+		});
+		lua_gc(L, LUA_GCCOLLECT, 0);
+
+		//borrowed ptr returned to lua, include the gc cost
+		lua_tinker::dostring(L, R"(function bench_push_object_borrowed(n)
+					for i = 1, n do local pFF = get_gff_ptr(); end
+				end
+			)");
+		bench_run_batch("push_object get_gff_ptr() in lua", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_push_object_borrowed", n); });
+		lua_gc(L, LUA_GCCOLLECT, 0);
+
+		//value type math in lua: constructor + operator return by value
+		std::string luabuf =
+			R"(function bench_push_object_value_math(n)
+					local sum = IntOpTest(0);
+					local one = IntOpTest(1);
+					for i = 1, n do sum = sum + one; end
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		bench_run_batch("push_object IntOpTest + IntOpTest in lua", nCount, [L](size_t n) { lua_tinker::call<void>(L, "bench_push_object_value_math", n); });
+		lua_gc(L, LUA_GCCOLLECT, 0);
+	};
+
+	g_bench_func_set["bench_userdata_memory"] = [L]()
+	{
+		const size_t nCount = 100000;
+		printf("%-48s %14zu bytes\n", "memory sizeof(UserDataWapper)", sizeof(lua_tinker::detail::UserDataWapper));
+		ff* pFF = get_gff_ptr();
+		bench_memory(L, "memory ff*", nCount, [L, pFF]() { lua_tinker::detail::push(L, pFF); });
+		std::shared_ptr<ff> ptrFF = make_ff();
+		bench_memory(L, "memory std::shared_ptr<ff>", nCount, [L, &ptrFF]() { lua_tinker::detail::push(L, ptrFF); });
+		bench_memory(L, "memory IntOpTest(val)", nCount, [L]() { lua_tinker::detail::push(L, IntOpTest(1)); });
+	};
+}
@@ -0,0 +1,145 @@
+#include "lua_tinker.h"
+#include "test.h"
+#include "bench.h"
+
+//c++ -> lua -> c++ of a container with nElem elements
+template<typename T>
+static void bench_container_echo(lua_State* L, const char* name, const T& val, size_t nElem)
+{
+	char szName[64];
+	snprintf(szName, sizeof(szName), "stl %s x%zu echo", name, nElem);
+	size_t nCount = std::max<size_t>(1000000 / nElem, 10);
+	bench_run(szName, nCount, [L, &val]()
+	{
+		lua_tinker::call<T>(L, "bench_stl_container_echo", val);
+	});
+}
+
+static float bench_stl_sum_float_vec(std::vector<float> vec)
+{
+	float fSum = 0;
+	for (auto v : vec)
+		fSum += v;
+	return fSum;
+}
+
+static std::vector<int> s_bench_view_vec(100000, 1);
+static std::vector<int> bench_stl_get_vec()
+{
+	return s_bench_view_vec;
+}
+static lua_tinker::view<const std::vector<int>&> bench_stl_get_view()
+{
+	return s_bench_view_vec;
+}
+
+void bench_stl_container(lua_State* L)
+{
+	g_bench_func_set["bench_stl_container"] = [L]()
+	{
+		std::string luabuf =
+			R"(function bench_stl_container_echo(p)
+					return p;
+				end
+				function bench_stl_container_peek(get, n)
+					local sum = 0;
+					for i = 1, n do
+						local v = get();
+						sum = sum + #v + v[1] + v[2];
+					end
+					return sum;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		lua_tinker::def(L, "bench_stl_get_vec", &bench_stl_get_vec);
+		lua_tinker::def(L, "bench_stl_get_view", &bench_stl_get_view);
+		lua_tinker::def(L, "bench_stl_sum_float_vec", &bench_stl_sum_float_vec);
+		lua_tinker::num_array_def<float>(L, "bench_float_array");
+		std::string luabuf_array =
+			R"(bench_stl_table_100k = {};
+				for i = 1, 100000 do bench_stl_table_100k[i] = i * 0.5; end
+				bench_stl_array_100k = bench_float_array(bench_stl_table_100k);
+				bench_stl_array2_100k = bench_float_array(bench_stl_table_100k);
+				function bench_stl_table_dot(n)
+					local a, b = bench_stl_table_100k, bench_stl_table_100k;
+					for j = 1, n do
+						local sum = 0;
+						for i = 1, #a do sum = sum + a[i] * b[i]; end
+					end
+				end
+				function bench_stl_array_dot(n)
+					local a, b = bench_stl_array_100k, bench_stl_array2_100k;
+					for j = 1, n do a:dot(b); end
+				end
+				function bench_stl_table_axpy(n)
+					local a, b = bench_stl_table_100k, bench_stl_table_100k;
+					for j = 1, n do
+						for i = 1, #a do a[i] = a[i] + 0.5 * b[i]; end
+					end
+				end
+				function bench_stl_array_axpy(n)
+					local a, b = bench_stl_array_100k, bench_stl_array2_100k;
+					for j = 1, n do a:axpy(0.5, b); end
+				end
+				function bench_stl_pass_vec(arg, n)
+					for j = 1, n do bench_stl_sum_float_vec(arg); end
+				end
+			)";
+		lua_tinker::dostring(L, luabuf_array.c_str());
+
+		const size_t nCount = 1000;
+		//64KB packet c++ -> lua -> c++
+		std::vector<uint8_t> vecPacket(64 * 1024);
+		for (size_t i = 0; i < vecPacket.size(); i++)
+			vecPacket[i] = (uint8_t)i;
+		bench_run("stl vector<uint8_t> 64KB echo", nCount, [L, &vecPacket]()
+		{
+			lua_tinker::call<std::vector<uint8_t>>(L, "bench_stl_container_echo", vecPacket);
+		});
+
+		for (size_t nElem : { 10, 1000, 100000 })
+		{
+			std::vector<int> vecInt;
+			std::vector<double> vecDouble;
+			std::map<std::string, int> mapStr;
+			std::vector<std::vector<int>> vecNested;
+			for (size_t i = 0; i < nElem; i++)
+			{
+				vecInt.push_back((int)i);
+				vecDouble.push_back(i * 0.5);
+				mapStr.emplace("key" + std::to_string(i), (int)i);
+				if (i % 10 == 0)
+					vecNested.emplace_back();
+				vecNested.back().push_back((int)i);
+			}
+			bench_container_echo(L, "vector<int>", vecInt, nElem);
+			bench_container_echo(L, "vector<double>", vecDouble, nElem);
+			bench_container_echo(L, "map<string,int>", mapStr, nElem);
+			bench_container_echo(L, "vector<vector<int>>", vecNested, nElem);
+		}
+	
+		//lua reads #v, v[1], v[2] of a 100K vector
+		bench_run_batch("stl return vector<int> x100000 peek", 100, [L](size_t n)
+		{
+			lua_tinker::call<int>(L, "bench_stl_container_peek", lua_tinker::get<lua_tinker::lua_function_ref<int>>(L, "bench_stl_get_vec"), n);
+		});
+		bench_run_batch("stl return view<vector<int>> x100000 peek", 1000000, [L](size_t n)
+		{
+			lua_tinker::call<int>(L, "bench_stl_container_peek", lua_tinker::get<lua_tinker::lua_function_ref<int>>(L, "bench_stl_get_view"), n);
+		});
+	
+		//100K float: lua table vs num_array
+		bench_run_batch("stl lua table dot x100000", 100, [L](size_t n) { lua_tinker::call<void>(L, "bench_stl_table_dot", n); });
+		bench_run_batch("stl num_array<float> dot x100000", 10000, [L](size_t n) { lua_tinker::call<void>(L, "bench_stl_array_dot", n); });
+		bench_run_batch("stl lua table axpy x100000", 100, [L](size_t n) { lua_tinker::call<void>(L, "bench_stl_table_axpy", n); });
+		bench_run_batch("stl num_array<float> axpy x100000", 10000, [L](size_t n) { lua_tinker::call<void>(L, "bench_stl_array_axpy", n); });
+		bench_run_batch("stl vector<float> param from table x100000", 100, [L](size_t n)
+		{
+			lua_tinker::call<void>(L, "bench_stl_pass_vec", lua_tinker::get<lua_tinker::table_onstack>(L, "bench_stl_table_100k"), n);
+		});
+		bench_run_batch("stl vector<float> param from num_array x100000", 1000, [L](size_t n)
+		{
+			lua_tinker::call<void>(L, "bench_stl_pass_vec", lua_tinker::get<lua_tinker::num_array<float>>(L, "bench_stl_array_100k"), n);
+		});
+	};
+}
@@ -0,0 +1,104 @@
+#include "lua_tinker.h"
+#include "test.h"
+#include "bench.h"
+
+//results of the reads go here so they are used
+static volatile int s_bench_table_sink = 0;
+
+void bench_table(lua_State* L)
+{
+	g_bench_func_set["bench_table"] = [L]()
+	{
+		std::string luabuf =
+			R"(bench_table_cfg = {};
+				for i = 1, 200 do bench_table_cfg["key" .. i] = i; end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		std::vector<std::string> vecKeys;
+		for (int i = 1; i <= 200; i++)
+			vecKeys.push_back("key" + std::to_string(i));
+
+		const size_t nCount = 10000;
+		//read 200 keys of a config table
+		bench_run("table table_onstack get x200", nCount, [L, &vecKeys]()
+		{
+			lua_tinker::table_onstack table(L, "bench_table_cfg");
+			int nSum = 0;
+			for (const auto& key : vecKeys)
+				nSum += table.get<int>(key.c_str());
+			s_bench_table_sink = nSum;
+		});
+		bench_run("table stack_table get x200", nCount, [L, &vecKeys]()
+		{
+			lua_getglobal(L, "bench_table_cfg");
+			lua_tinker::stack_table table(L, -1);
+			int nSum = 0;
+			for (const auto& key : vecKeys)
+				nSum += table.get<int>(key.c_str());
+			s_bench_table_sink = nSum;
+			lua_pop(L, 1);
+		});
+		//same keys interned once
+		std::vector<lua_tinker::key> vecInterned;
+		for (const auto& key : vecKeys)
+			vecInterned.emplace_back(L, key.c_str());
+		bench_run("table stack_table get key x200", nCount, [L, &vecInterned]()
+		{
+			lua_getglobal(L, "bench_table_cfg");
+			lua_tinker::stack_table table(L, -1);
+			int nSum = 0;
+			for (const auto& key : vecInterned)
+				nSum += table.get<int>(key);
+			s_bench_table_sink = nSum;
+			lua_pop(L, 1);
+		});
+		//the table was moved by a removed slot below it, table_onstack finds it again by scanning the stack
+		bench_run("table table_onstack moved get x200", nCount, [L, &vecKeys]()
+		{
+			lua_pushnil(L);
+			lua_tinker::table_onstack table(L, "bench_table_cfg");
+			lua_remove(L, -2);
+			int nSum = 0;
+			for (const auto& key : vecKeys)
+				nSum += table.get<int>(key.c_str());
+			s_bench_table_sink = nSum;
+		});
+		bench_run("table table_onstack create+set x200", nCount, [L, &vecKeys]()
+		{
+			lua_tinker::table_onstack table(L);
+			for (size_t i = 0; i < vecKeys.size(); i++)
+				table.set(vecKeys[i].c_str(), (int)i);
+		});
+		bench_run("table stack_table create(0,200)+set x200", nCount, [L, &vecKeys]()
+		{
+			lua_tinker::stack_table table = lua_tinker::stack_table::create(L, 0, (int)vecKeys.size());
+			for (size_t i = 0; i < vecKeys.size(); i++)
+				table.set(vecKeys[i].c_str(), (int)i);
+			lua_pop(L, 1);
+		});
+	
+		//long-lived ref to a config table, read 3 fields
+		lua_tinker::table_ref cfg_ref = lua_tinker::get<lua_tinker::table_ref>(L, "bench_table_cfg");
+		bench_run("table table_ref push_table_to_stack get x3", nCount * 100, [&cfg_ref]()
+		{
+			lua_tinker::table_onstack table = cfg_ref.push_table_to_stack();
+			int nSum = table.get<int>("key1") + table.get<int>("key2") + table.get<int>("key3");
+			s_bench_table_sink = nSum;
+		});
+		bench_run("table table_ref get x3", nCount * 100, [&cfg_ref]()
+		{
+			int nSum = cfg_ref.get<int>("key1") + cfg_ref.get<int>("key2") + cfg_ref.get<int>("key3");
+			s_bench_table_sink = nSum;
+		});
+		bench_run("table table_ref get_many<int,int,int>", nCount * 100, [&cfg_ref]()
+		{
+			std::tuple<int, int, int> result = cfg_ref.get_many<int, int, int>("key1", "key2", "key3");
+			s_bench_table_sink = std::get<0>(result) + std::get<1>(result) + std::get<2>(result);
+		});
+		bench_run("table table_ref get key x3", nCount * 100, [&cfg_ref, &vecInterned]()
+		{
+			int nSum = cfg_ref.get<int>(vecInterned[0]) + cfg_ref.get<int>(vecInterned[1]) + cfg_ref.get<int>(vecInterned[2]);
+			s_bench_table_sink = nSum;
+		});
+	};
+}
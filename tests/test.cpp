@@ -68,9 +68,10 @@ void on_lua_close(lua_State* L)
 }
 
 std::map<std::string, std::function<bool()> > g_test_func_set;
+std::map<std::string, std::function<void()> > g_bench_func_set;
 
 
-int main()
+int main(int argc, char** argv)
 {
 	lua_State* L = luaL_newstate();
 	luaL_openlibs(L);
@@ -87,6 +88,30 @@ int main()
 
 	lua_tinker::register_lua_close_callback(L, lua_tinker::Lua_Close_CallBack_Func(on_lua_close));
 
+	if (argc > 1 && std::string(argv[1]) == "bench")
+	{
+		extern void bench_push_object(lua_State* L);
+		extern void bench_inherit(lua_State* L);
+		extern void bench_class_member(lua_State* L);
+		extern void bench_function(lua_State* L);
+		extern void bench_stl_container(lua_State* L);
+		extern void bench_table(lua_State* L);
+
+		bench_push_object(L);
+		bench_inherit(L);
+		bench_class_member(L);
+		bench_function(L);
+		bench_stl_container(L);
+		bench_table(L);
+
+		for (const auto& v : g_bench_func_set)
+		{
+			v.second();
+		}
+		lua_close(L);
+		return 0;
+	}
+
 
 
 
@@ -113,13 +138,16 @@ int main()
 	extern void test_gloabl_func(lua_State* L);
 	extern void test_inherit(lua_State* L);
 	extern void test_inherit_in_lua(lua_State* L);
+	extern void test_identity_cache(lua_State* L);
 	extern void test_inner_class(lua_State* L);
 	extern void test_int64(lua_State* L);
 	extern void test_luafunction_ref(lua_State* L);
 	extern void test_lua_table_ref(lua_State* L);
+	extern void test_lua_state(lua_State* L);
 	extern void test_member_func(lua_State* L);
 	extern void test_multireturn(lua_State* L);
 	extern void test_namespace(lua_State* L);
+	extern void test_num_array(lua_State* L);
 	extern void test_sharedptr(lua_State* L);
 	extern void test_stl_container(lua_State* L);
 	extern void test_string(lua_State* L);
@@ -136,13 +164,16 @@ int main()
 	test_gloabl_func(L);
 	test_inherit(L);
 	test_inherit_in_lua(L);
+	test_identity_cache(L);
 	test_inner_class(L);
 	test_int64(L);
 	test_luafunction_ref(L);
 	test_lua_table_ref(L);
+	test_lua_state(L);
 	test_member_func(L);
 	test_multireturn(L);
 	test_namespace(L);
+	test_num_array(L);
 	test_sharedptr(L);
 	test_stl_container(L);
 	test_string(L);
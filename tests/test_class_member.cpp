@@ -2,6 +2,17 @@
 #include"test.h"
 extern std::map<std::string, std::function<bool()> > g_test_func_set;
 
+//count alive objects, owner userdata must still be finalized after borrowed pushes
+struct borrowed_gc_obj
+{
+	borrowed_gc_obj() { s_nAlive++; }
+	borrowed_gc_obj(const borrowed_gc_obj&) { s_nAlive++; }
+	~borrowed_gc_obj() { s_nAlive--; }
+	int get_alive() const { return s_nAlive; }
+	static int s_nAlive;
+};
+int borrowed_gc_obj::s_nAlive = 0;
+
 void test_class_member(lua_State* L)
 {
 
@@ -18,6 +29,59 @@ void test_class_member(lua_State* L)
 		lua_tinker::dostring(L, luabuf.c_str());
 		return  lua_tinker::call<bool>(L, "test_lua_member_property");
 	};
+	g_test_func_set["test_lua_member_field_table"] = [L]()->bool
+	{
+		//long string is not interned, must fall back to rawget
+		lua_tinker::class_mem<IntOpTest>(L, "m_n_alias_with_a_long_name_more_than_40_chars", &IntOpTest::m_n);
+		std::string luabuf =
+			R"(function test_lua_member_field_table()
+					local Intop = IntOpTest(5);
+					local key = "m_" .. "n";
+					Intop[key] = 6;
+					local long_key = "m_n_alias_with_a_long_name_" .. "more_than_40_chars";
+					Intop[long_key] = Intop[long_key] + 1;
+					return Intop.m_n == 7 and Intop.m_n_alias_with_a_long_name_more_than_40_chars == 7 and (Intop + Intop).m_n == 14;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_member_field_table");
+	};
+	g_test_func_set["test_lua_member_borrowed_ptr"] = [L]()->bool
+	{
+		//borrowed ptr use the same class_meta, __gc is kept for owners
+		std::string luabuf =
+			R"(function test_lua_member_borrowed_ptr()
+					local pFF = get_gff_ptr();
+					local local_ff = ff(2);
+					return getmetatable(pFF) == ff and getmetatable(local_ff) == ff and rawget(ff, "__gc") ~= nil and pFF:getVal() == get_gff_ptr():getVal();
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_member_borrowed_ptr");
+	};
+	g_test_func_set["test_lua_member_borrowed_gc"] = [L]()->bool
+	{
+		static borrowed_gc_obj s_borrowed;
+		lua_tinker::class_add<borrowed_gc_obj>(L, "borrowed_gc_obj", false);
+		lua_tinker::class_def<borrowed_gc_obj>(L, "get_alive", &borrowed_gc_obj::get_alive);
+		lua_tinker::def(L, "get_borrowed_gc_obj", std::function<borrowed_gc_obj*()>([]() { return &s_borrowed; }));
+		lua_tinker::def(L, "make_borrowed_gc_obj", std::function<borrowed_gc_obj()>([]() { return borrowed_gc_obj(); }));
+		std::string luabuf =
+			R"(function test_lua_member_borrowed_gc()
+					collectgarbage("collect");
+					local nAlive = get_borrowed_gc_obj():get_alive();
+					for i = 1, 100 do get_borrowed_gc_obj(); end
+					for i = 1, 10 do make_borrowed_gc_obj(); end
+					for i = 1, 100 do get_borrowed_gc_obj(); end
+					local bGrow = get_borrowed_gc_obj():get_alive() == nAlive + 10;
+					collectgarbage("collect");
+					collectgarbage("collect");
+					return bGrow and rawget(borrowed_gc_obj, "__gc") ~= nil and get_borrowed_gc_obj():get_alive() == nAlive;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_member_borrowed_gc");
+	};
 	g_test_func_set["test_lua_member_readonly_1"] = [L]()->bool
 	{
 		std::string luabuf =
@@ -53,6 +53,21 @@ int test_overload_default(int n1, int n2, int n3, double d1/*=1.0*/, double d2 /
 	return n1 + n2;
 }
 
+int test_overload_class(ff_base* p)
+{
+	return 1;
+}
+
+int test_overload_class(ff_other_base* p)
+{
+	return 2;
+}
+
+int test_overload_class(ff* p)
+{
+	return 3;
+}
+
 
 void test_overloadfunc(lua_State* L)
 {
@@ -154,6 +169,25 @@ void test_overloadfunc(lua_State* L)
 
 
 
+	g_test_func_set["test_lua_coverloadfunc_class"] = [L]()->bool
+	{
+		lua_tinker::def(L, "test_overload_class", lua_tinker::args_type_overload_functor(
+			lua_tinker::make_functor_ptr((int(*)(ff_base*))(&test_overload_class)),
+			lua_tinker::make_functor_ptr((int(*)(ff_other_base*))(&test_overload_class)),
+			lua_tinker::make_functor_ptr((int(*)(ff*))(&test_overload_class))));
+		lua_tinker::set(L, "g_overload_ff_base", static_cast<ff_base*>(get_gff_ptr()));
+		lua_tinker::set(L, "g_overload_ff_other_base", static_cast<ff_other_base*>(get_gff_ptr()));
+		std::string luabuf =
+			R"(function test_lua_coverloadfunc_class()
+					return test_overload_class(get_gff_ptr()) == 3 and test_overload_class(g_overload_ff_base) == 1
+						and test_overload_class(g_overload_ff_other_base) == 2
+						and pcall(test_overload_class, io.stdout) == false;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_coverloadfunc_class");
+	};
+
 	g_test_func_set["test_lua_member_overloadfunc_1"] = [L]()->bool
 	{
 		std::string luabuf =
@@ -162,5 +162,23 @@ void test_gloabl_func(lua_State* L)
 		return 2 == lua_tinker::call<int>(L, "test_lua_cfunc_8");
 	};
 
+	g_test_func_set["test_lua_cfunc_bound"] = [L]()->bool
+	{
+		lua_tinker::def<LUATINKER_BIND(&gint_addint)>(L, "gint_addint_bound");
+		lua_tinker::def<LUATINKER_BIND(&get_gint)>(L, "get_gint_bound");
+		lua_tinker::def<LUATINKER_BIND(&g_addint_double)>(L, "g_addint_double_bound", 2.0);
+		std::string luabuf =
+			R"(function test_lua_cfunc_bound()
+					gint_addint_bound(1);
+					g_addint_double_bound(1);	--default 2.0
+					return get_gint_bound() == 2 and get_gdouble() == 2.0 and debug.getupvalue(gint_addint_bound, 1) == nil;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		g_c_int = 0;
+		g_c_double = 0.0;
+		return lua_tinker::call<bool>(L, "test_lua_cfunc_bound");
+	};
+
 
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "lua_tinker.h"
+#include"test.h"
+
+extern std::map<std::string, std::function<bool()> > g_test_func_set;
+
+void test_identity_cache(lua_State* L)
+{
+	g_test_func_set["test_lua_identity_cache_1"] = [L]()->bool
+	{
+		lua_tinker::class_identity_cache<ff_other_baseA>(L);
+		static ff_other_baseA s_obj;
+		ff_other_baseA* pObj = &s_obj;
+		const ff_other_baseA* pConstObj = &s_obj;
+		lua_tinker::set(L, "g_identity_1", pObj);
+		lua_tinker::set(L, "g_identity_2", pObj);
+		lua_tinker::detail::push<ff_other_baseA&>(L, s_obj);
+		lua_setglobal(L, "g_identity_3");
+		lua_tinker::set(L, "g_identity_const", pConstObj);
+		lua_tinker::forget(L, pObj);
+		lua_tinker::set(L, "g_identity_forget", pObj);
+		std::string luabuf =
+			R"(function test_lua_identity_cache_1()
+					local tbl = {};
+					tbl[g_identity_1] = true;
+					return rawequal(g_identity_1, g_identity_2) and rawequal(g_identity_1, g_identity_3) and tbl[g_identity_2] == true
+						and not rawequal(g_identity_1, g_identity_const) and not rawequal(g_identity_1, g_identity_forget);
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		bool bResult = lua_tinker::call<bool>(L, "test_lua_identity_cache_1");
+		lua_tinker::dostring(L, "g_identity_1 = nil; g_identity_2 = nil; g_identity_3 = nil; g_identity_const = nil; g_identity_forget = nil;");
+		lua_tinker::forget(L, pObj);
+		return bResult;
+	};
+
+	g_test_func_set["test_lua_identity_cache_2"] = [L]()->bool
+	{
+		lua_tinker::class_identity_cache<ff_other_baseA>(L);
+		std::shared_ptr<ff_other_baseA> ptrObj = std::make_shared<ff_other_baseA>();
+		lua_tinker::set(L, "g_identity_shared_1", ptrObj);
+		lua_tinker::set(L, "g_identity_shared_2", ptrObj);
+		bool bResult = lua_tinker::dostring<bool>(L, "return rawequal(g_identity_shared_1, g_identity_shared_2)");
+		//lua hold the last owner now, the weak holder can't be reused
+		const void* pRaw = ptrObj.get();
+		lua_tinker::set(L, "g_identity_shared_3", std::move(ptrObj));
+		bResult = bResult && lua_tinker::dostring<bool>(L, "return not rawequal(g_identity_shared_1, g_identity_shared_3)");
+		bResult = bResult && lua_tinker::get<std::shared_ptr<ff_other_baseA>>(L, "g_identity_shared_3").get() == pRaw;
+		lua_tinker::dostring(L, "g_identity_shared_1 = nil; g_identity_shared_2 = nil; g_identity_shared_3 = nil;");
+		lua_tinker::class_identity_cache<ff_other_baseA>(L, false);
+		return bResult;
+	};
+}
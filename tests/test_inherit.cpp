@@ -1,4 +1,5 @@
 #include "lua_tinker.h"
+#include"test.h"
 
 extern std::map<std::string, std::function<bool()> > g_test_func_set;
 
@@ -28,7 +29,163 @@ void test_inherit(lua_State* L)
 		return  lua_tinker::call<bool>(L, "test_lua_inherit_3");
 	};
 
+	g_test_func_set["test_lua_inherit_cache_1"] = [L]()->bool
+	{
+		std::string luabuf =
+			R"(function test_lua_inherit_cache_1()
+					local pFF = get_gff_ptr();
+					local bResult = pFF:test_base_callfn(1) == 1 and pFF:test_base_callfn(2) == 2;
+					function ff_base:test_base_add_in_lua(x)
+						return x + 1;
+					end
+					return bResult and pFF:test_base_add_in_lua(1) == 2;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_inherit_cache_1");
+	};
+
+	g_test_func_set["test_lua_inherit_cache_2"] = [L]()->bool
+	{
+		lua_tinker::class_def<ff_base>(L, "test_base_def_later", std::function<int(ff_base*, int)>([](ff_base*, int n)->int { return n; }));
+		std::string luabuf =
+			R"(function test_lua_inherit_cache_2(n)
+					local pFF = get_gff_ptr();
+					return pFF:test_base_def_later(n);
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		bool bResult = lua_tinker::call<int>(L, "test_lua_inherit_cache_2", 3) == 3;
+		//redefine in base after derived visited it
+		lua_tinker::class_def<ff_base>(L, "test_base_def_later", std::function<int(ff_base*, int)>([](ff_base*, int n)->int { return n * 2; }));
+		return bResult && lua_tinker::call<int>(L, "test_lua_inherit_cache_2", 3) == 6;
+	};
+
+	g_test_func_set["test_lua_inherit_cast_1"] = [L]()->bool
+	{
+		//ff_base is not the first base of ff, this ptr must be adjusted
+		lua_tinker::class_def<ff_base>(L, "test_base_this", std::function<bool(ff_base*)>([](ff_base* pThis)->bool { return pThis == static_cast<ff_base*>(get_gff_ptr()); }));
+		lua_tinker::def(L, "visot_ffbase_ptr", std::function<bool(ff_base*)>([](ff_base* p)->bool { return p == static_cast<ff_base*>(get_gff_ptr()); }));
+		std::string luabuf =
+			R"(function test_lua_inherit_cast_1()
+					local pFF = get_gff_ptr();
+					return pFF:test_base_this() and visot_ffbase_ptr(pFF);
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_inherit_cast_1");
+	};
+
+#ifdef LUATINKER_NATIVE_METHOD_INDEX
+	g_test_func_set["test_lua_native_index_1"] = [L]()->bool
+	{
+		lua_tinker::set(L, "g_ff_other_baseB", static_cast<ff_other_baseB*>(get_gff_ptr()));
+		std::string luabuf =
+			R"(function test_lua_native_index_1()
+					local pFF = get_gff_ptr();
+					local pB = g_ff_other_baseB;
+					local bResult = pB:test_other_callfn(1) == 1 and pFF:test_other_callfn(2) == 2;
+					--ff_other_baseB and ff_other_base have no member var, ff have
+					bResult = bResult and rawget(ff_other_baseB, "__index") == ff_other_baseB and rawget(ff, "__index") ~= ff;
+					return bResult and pB:test_other_callfn(3) == 3 and pB.no_name == nil;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_native_index_1");
+	};
+
+	g_test_func_set["test_lua_native_index_2"] = [L]()->bool
+	{
+		lua_tinker::set(L, "g_ff_other_baseB", static_cast<ff_other_baseB*>(get_gff_ptr()));
+		std::string luabuf =
+			R"(function test_lua_native_index_2(n)
+					local pB = g_ff_other_baseB;
+					pB:test_other_callfn(1);
+					return pB:test_other_native_later(n);
+				end
+				function test_lua_native_index_2_check()
+					return rawget(ff_other_baseB, "__index") == ff_other_baseB;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		lua_tinker::class_def<ff_other_base>(L, "test_other_native_later", std::function<int(ff_other_base*, int)>([](ff_other_base*, int n)->int { return n; }));
+		bool bResult = lua_tinker::call<int>(L, "test_lua_native_index_2", 3) == 3 && lua_tinker::call<bool>(L, "test_lua_native_index_2_check");
+		//register a member var to parent, switch back to meta_get
+		static int s_native_prop = 7;
+		lua_tinker::class_mem_static<ff_other_base>(L, "test_other_native_prop", &s_native_prop);
+		return bResult && lua_tinker::call<bool>(L, "test_lua_native_index_2_check") == false
+			&& lua_tinker::dostring<int>(L, "return g_ff_other_baseB.test_other_native_prop") == 7;
+	};
+#endif
+
+#ifdef LUATINKER_INHERIT_CACHE
+	g_test_func_set["test_lua_inherit_cache_4"] = [L]()->bool
+	{
+		std::string luabuf =
+			R"(function test_lua_inherit_cache_4()
+					local pFF = get_gff_ptr();
+					pFF:test_base_callfn(1);
+					local bCached = rawget(ff, "test_base_callfn") ~= nil;
+					function ff_base:test_base_flush_cache() end
+					return bCached and rawget(ff, "test_base_callfn") == nil and pFF:test_base_callfn(1) == 1;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_inherit_cache_4");
+	};
+
+	g_test_func_set["test_lua_inherit_cache_5"] = [L]()->bool
+	{
+		std::string luabuf =
+			R"(function test_lua_inherit_cache_5()
+					local pFF = get_gff_ptr();
+					pFF:test_base_callfn(1);
+					--key is cached, so this is a raw write without __newindex
+					function ff:test_base_callfn(n) return n + 1000; end
+					function ff_base:test_base_flush_cache_5() end
+					local bResult = pFF:test_base_callfn(1) == 1001;
+					ff.test_base_callfn = nil;
+					return bResult and pFF:test_base_callfn(1) == 1;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_inherit_cache_5");
+	};
+#endif
+
 #ifdef LUATINKER_MULTI_INHERITANCE
+	g_test_func_set["test_lua_inherit_cache_3"] = [L]()->bool
+	{
+		lua_tinker::class_def<ff_other_base>(L, "test_other_shadow", std::function<int(ff_other_base*, int)>([](ff_other_base*, int n)->int { return n; }));
+		std::string luabuf =
+			R"(function test_lua_inherit_cache_3()
+					local pFF = get_gff_ptr();
+					local bResult = pFF:test_other_shadow(1) == 1;
+					function ff_other:test_other_shadow(n)
+						return n + 100;
+					end
+					return bResult and pFF:test_other_shadow(1) == 101;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_inherit_cache_3");
+	};
+
+	g_test_func_set["test_lua_inherit_cast_2"] = [L]()->bool
+	{
+		//ff -> ff_other -> ff_other_baseB -> ff_other_base
+		lua_tinker::class_def<ff_other_base>(L, "test_other_this", std::function<bool(ff_other_base*)>([](ff_other_base* pThis)->bool { return pThis == static_cast<ff_other_base*>(get_gff_ptr()); }));
+		lua_tinker::def(L, "visot_ff_other_baseB_ptr", std::function<bool(ff_other_baseB*)>([](ff_other_baseB* p)->bool { return p == static_cast<ff_other_baseB*>(get_gff_ptr()); }));
+		std::string luabuf =
+			R"(function test_lua_inherit_cast_2()
+					local pFF = get_gff_ptr();
+					return pFF:test_other_this() and visot_ff_other_baseB_ptr(pFF);
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return  lua_tinker::call<bool>(L, "test_lua_inherit_cast_2");
+	};
+
 	g_test_func_set["test_lua_inherit_2"] = [L]()->bool
 	{
 		std::string luabuf =
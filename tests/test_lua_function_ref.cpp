@@ -169,4 +169,78 @@ void test_luafunction_ref(lua_State* L)
 		}
 		return g_lua_func_ref(8) == 9;
 	};
+
+	g_test_func_set["test_lua_luafunction_ref_copy"] = [L]()->bool
+	{
+		lua_tinker::dostring(L, "function test_lua_luafunction_ref_copy(val) return val + 2; end");
+		lua_tinker::lua_function_ref<int> ref_copy;
+		{
+			lua_tinker::lua_function_ref<int> lua_func = lua_tinker::get<decltype(lua_func)>(L, "test_lua_luafunction_ref_copy");
+			std::vector<lua_tinker::lua_function_ref<int>> vecRef(8, lua_func);
+			ref_copy = vecRef.back();
+		}
+		//the last copy still hold the function
+		lua_tinker::dostring(L, "test_lua_luafunction_ref_copy = nil; collectgarbage()");
+		return ref_copy(1) == 3;
+	};
+
+	g_test_func_set["test_lua_luafunction_unique_ref"] = [L]()->bool
+	{
+		lua_tinker::dostring(L, "function test_lua_luafunction_unique_ref(val) return val + 3; end");
+		lua_tinker::lua_function_unique_ref<int> lua_func = lua_tinker::get<decltype(lua_func)>(L, "test_lua_luafunction_unique_ref");
+		lua_tinker::lua_function_unique_ref<int> lua_func_moved(std::move(lua_func));
+		return lua_func.empty() && lua_func_moved(1) == 4;
+	};
+
+	g_test_func_set["test_lua_call_batch"] = [L]()->bool
+	{
+		lua_tinker::dostring(L, R"(function test_lua_call_batch(n, d)
+					if n == 3 then error("bad item"); end
+					return n + math.floor(d);
+				end
+			)");
+		lua_tinker::lua_function_ref<int> lua_func = lua_tinker::get<decltype(lua_func)>(L, "test_lua_call_batch");
+		std::vector<std::tuple<int, double>> vecArgs = { std::make_tuple(1, 1.0), std::make_tuple(2, 2.0), std::make_tuple(3, 3.0), std::make_tuple(4, 4.0) };
+		std::vector<int> vecResult(vecArgs.size(), -1);
+		std::vector<lua_tinker::call_batch_error> vecErrors;
+		size_t nFailed = lua_tinker::call_batch<int>(lua_func, vecArgs.begin(), vecArgs.end(), vecResult.begin(), &vecErrors);
+		if (nFailed != 1 || vecErrors.size() != 1 || vecErrors[0].m_index != 2 || vecErrors[0].m_msg.find("bad item") == std::string::npos)
+			return false;
+		if (vecResult != std::vector<int>{ 2, 4, 0, 8 })
+			return false;
+
+		//single arg items, void result
+		lua_tinker::dostring(L, "g_test_lua_call_batch_sum = 0; function test_lua_call_batch_sum(n) g_test_lua_call_batch_sum = g_test_lua_call_batch_sum + n; end");
+		lua_tinker::call_handle<void(int)> handle(L, "test_lua_call_batch_sum");
+		std::vector<int> vecInt = { 1, 2, 3 };
+		return lua_tinker::call_batch<void>(handle, vecInt.begin(), vecInt.end(), nullptr) == 0
+			&& lua_tinker::get<int>(L, "g_test_lua_call_batch_sum") == 6;
+	};
+
+	g_test_func_set["test_lua_call_handle_1"] = [L]()->bool
+	{
+		lua_tinker::dostring(L, "function test_lua_call_handle_1(a, b) return a + b; end");
+		lua_tinker::call_handle<int(int, int)> handle(L, "test_lua_call_handle_1");
+		if (handle.empty() || handle(1, 2) != 3)
+			return false;
+		//hot reload, the handle still call the old one until rebind
+		lua_tinker::dostring(L, "function test_lua_call_handle_1(a, b) return a * b; end");
+		if (handle(2, 3) != 5)
+			return false;
+		handle.rebind();
+		lua_tinker::call_handle<int(int, int)> handle_moved(std::move(handle));
+		lua_tinker::call_handle<void(int)> handle_default;
+		handle_default(1);
+		return handle.empty() && handle(2, 3) == 0 && handle_moved(2, 3) == 6;
+	};
+
+	g_test_func_set["test_lua_call_handle_2"] = [L]()->bool
+	{
+		lua_tinker::dostring(L, "function test_lua_call_handle_2(pFF) pFF:setVal(7); return pFF:getVal(); end");
+		lua_tinker::call_handle<int(ff&)> handle(L, "test_lua_call_handle_2");
+		ff& ref_ff = *get_gff_ptr();
+		ref_ff.setVal(0);
+		//ff& is pushed as a ref, lua change the c++ obj
+		return handle(ref_ff) == 7 && ref_ff.getVal() == 7;
+	};
 }
\ No newline at end of file
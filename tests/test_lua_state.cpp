@@ -0,0 +1,99 @@
+#include "lua_tinker.h"
+#include"test.h"
+extern std::map<std::string, std::function<bool()> > g_test_func_set;
+
+static int s_state_error_count = 0;
+
+struct state_bind_obj
+{
+	int get_val() const { return m_val; }
+	int m_val = 7;
+};
+
+void test_lua_state(lua_State* L)
+{
+	g_test_func_set["test_lua_state_error_callback"] = [L]()->bool
+	{
+		//a second state with its own error callback, L keeps the global one
+		lua_State* L2 = luaL_newstate();
+		luaL_openlibs(L2);
+		lua_tinker::init(L2);
+		lua_tinker::set_error_callback(L2, [](lua_State *L) -> int
+		{
+			s_state_error_count++;
+			return 0;
+		});
+
+		std::string luabuf =
+			R"(function test_lua_state_err()
+					error("this is my test error");
+				end
+			)";
+		lua_tinker::dostring(L2, luabuf.c_str());
+		size_t nCallError = lua_tinker::get_state_stats(L2)->m_nCallError;
+		s_state_error_count = 0;
+		lua_tinker::call<void>(L2, "test_lua_state_err");
+
+		//a coroutine share the context of its main state
+		lua_State* co = lua_newthread(L2);
+		lua_tinker::call<int>(co, "test_lua_state_err");
+		lua_pop(L2, 1);
+
+		//call_batch without an error list report every failed item to the state's callback
+		{
+			lua_tinker::call_handle<void()> handle(L2, "test_lua_state_err");
+			std::vector<std::tuple<>> vecArgs(2);
+			lua_tinker::call_batch<void>(handle, vecArgs.begin(), vecArgs.end(), nullptr);
+		}
+
+		bool bResult = s_state_error_count == 4 && lua_tinker::get_state_stats(L2)->m_nCallError == nCallError + 4
+			&& lua_tinker::get_error_callback(L2) != lua_tinker::get_error_callback(L)
+			&& lua_tinker::get_error_callback(L) == lua_tinker::get_error_callback();
+		lua_close(L2);
+
+		lua_tinker::set_error_callback(L, [](lua_State *L) -> int { return 0; });
+		bResult = bResult && lua_tinker::get_error_callback(L) != lua_tinker::get_error_callback();
+		lua_tinker::set_error_callback(L, nullptr);
+		return bResult && lua_tinker::get_error_callback(L) == &lua_tinker::on_error;
+	};
+
+	g_test_func_set["test_lua_state_type_name"] = [L]()->bool
+	{
+		//the same type bound with a different name in each state
+		lua_State* vecStates[2] = { luaL_newstate(), luaL_newstate() };
+		const char* vecNames[2] = { "bind_obj_a", "bind_obj_b" };
+		bool bResult = true;
+		for (int i = 0; i < 2; i++)
+		{
+			lua_State* L2 = vecStates[i];
+			luaL_openlibs(L2);
+			lua_tinker::init(L2);
+			lua_tinker::class_add<state_bind_obj>(L2, vecNames[i], true);
+			lua_tinker::class_def<state_bind_obj>(L2, "get_val", &state_bind_obj::get_val);
+		}
+		state_bind_obj obj;
+		for (int i = 0; i < 2; i++)
+		{
+			lua_State* L2 = vecStates[i];
+			std::string luabuf = std::string("function test_lua_state_type_name(obj) return obj:get_val() == 7 and getmetatable(obj) == ") + vecNames[i] + "; end";
+			lua_tinker::dostring(L2, luabuf.c_str());
+			bResult = bResult && lua_tinker::call<bool>(L2, "test_lua_state_type_name", &obj)
+				&& strcmp(lua_tinker::detail::get_class_name<state_bind_obj>(L2), vecNames[i]) == 0
+				&& lua_tinker::detail::get_class_name<std::shared_ptr<state_bind_obj>>(L2) == std::string(vecNames[i]) + lua_tinker::S_SHARED_PTR_NAME;
+		}
+		//a name got before a rebind stays valid
+		{
+			lua_State* L2 = vecStates[0];
+			size_t nTypeIdx = lua_tinker::detail::get_type_idx<state_bind_obj>();
+			const char* pOldName = lua_tinker::detail::get_type_name(L2, nTypeIdx);
+			lua_tinker::detail::set_type_name(L2, nTypeIdx, "bind_obj_rebind_with_a_name_longer_than_sso");
+			bResult = bResult && strcmp(pOldName, vecNames[0]) == 0
+				&& strcmp(lua_tinker::detail::get_type_name(L2, nTypeIdx), "bind_obj_rebind_with_a_name_longer_than_sso") == 0;
+		}
+		for (int i = 0; i < 2; i++)
+			lua_close(vecStates[i]);
+		//never bound in L
+		return bResult && strcmp(lua_tinker::detail::get_class_name<state_bind_obj>(L), "") == 0
+			&& strcmp(lua_tinker::detail::get_class_name<std::shared_ptr<state_bind_obj>>(L), lua_tinker::S_SHARED_PTR_NAME) == 0;
+	};
+}
@@ -3,6 +3,12 @@
 extern std::map<std::string, std::function<bool()> > g_test_func_set;
 
 lua_tinker::table_ref g_table_ref;
+
+int stack_table_sum(lua_tinker::stack_table table)
+{
+	return table.get<int>("a") + table.get<int>(1);
+}
+
 void test_lua_table_ref(lua_State* L)
 {
 
@@ -111,4 +117,76 @@ void test_lua_table_ref(lua_State* L)
 		return !bFail;
 	};
 
-}
\ No newline at end of file
+	g_test_func_set["test_lua_stack_table"] = [L]()->bool
+	{
+		lua_tinker::def(L, "stack_table_sum", &stack_table_sum);
+		std::string luabuf =
+			R"(function test_lua_stack_table(t)
+					return t.name == "cfg" and t[2] == 20 and #t == 2 and stack_table_sum({5, a = 6}) == 11;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+
+		lua_tinker::stack_table table = lua_tinker::stack_table::create(L, 2, 1);
+		table.set("name", "cfg");
+		table.set(1, 10);
+		table.set(2, 20);
+		bool bResult = table.len() == 2 && table.get<std::string>("name") == "cfg" && table.get<int>(1) == 10
+			&& table.convertto<std::vector<int>>() == std::vector<int>{ 10, 20 } && lua_tinker::call<bool>(L, "test_lua_stack_table", table);
+		lua_pop(L, 1);
+
+		lua_tinker::table_onstack table2(L, 0, 2);
+		table2.set("x", 1);
+		return bResult && table2.get<int>("x") == 1;
+	};
+	g_test_func_set["test_lua_table_ref_get_set"] = [L]()->bool
+	{
+		std::string luabuf =
+			R"(g_test_table_ref_cfg = setmetatable({ name = "cfg", [1] = 10, rate = 0.5 }, { __index = function(t, k) return "default"; end });
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		lua_tinker::table_ref cfg_ref = lua_tinker::get<lua_tinker::table_ref>(L, "g_test_table_ref_cfg");
+		int nTop = lua_gettop(L);
+
+		cfg_ref.set("level", 3);
+		cfg_ref.rawset(2, "two");
+		std::string strName;
+		int nFirst = 0;
+		double fRate = 0;
+		std::tie(strName, nFirst, fRate) = cfg_ref.get_many<std::string, int, double>("name", 1, "rate");
+		bool bResult = strName == "cfg" && nFirst == 10 && fRate == 0.5
+			&& cfg_ref.get<int>("level") == 3 && cfg_ref.get<std::string>(2) == "two"
+			&& cfg_ref.get<std::string>("missing") == "default" && cfg_ref.rawget<std::string>("missing").empty();
+		return bResult && lua_gettop(L) == nTop;
+	};
+
+	g_test_func_set["test_lua_key"] = [L]()->bool
+	{
+		std::string luabuf =
+			R"(g_test_key_table = { hp = 100 };
+			function test_lua_key()
+				return rawget(ff, "__parent") == ff_base and rawget(ff, "__multi_parent")[1] == ff_other;
+			end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		lua_tinker::key k_hp(L, "hp");
+		lua_tinker::key k_mp(L, "mp");
+		lua_tinker::key k_fn(L, "test_function_in_namespace");
+		int nTop = lua_gettop(L);
+
+		lua_tinker::table_ref ref = lua_tinker::get<lua_tinker::table_ref>(L, "g_test_key_table");
+		ref.set(k_mp, 50);
+		bool bResult = ref.get<int>(k_hp) == 100 && ref.rawget<int>(k_mp) == 50;
+
+		{
+			lua_tinker::table_onstack table(L, "g_test_key_table");
+			table.set(k_hp, table.get<int>(k_hp) + 1);
+			lua_tinker::stack_table st(L, table.m_obj->m_index);
+			bResult = bResult && st.get<int>(k_hp) == 101 && st.get<int>("hp") == 101;
+		}
+
+		bResult = bResult && lua_tinker::namespace_get<lua_tinker::lua_function_ref<int>>(L, "NS_TEST", k_fn).empty() == false
+			&& lua_tinker::namespace_get<int>(L, "NS_TEST", k_mp) == 0;
+		return bResult && lua_gettop(L) == nTop && lua_tinker::call<bool>(L, "test_lua_key");
+	};
+}
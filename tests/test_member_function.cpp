@@ -93,6 +93,26 @@ void test_member_func(lua_State* L)
 		return 44 == lua_tinker::call<int>(L, "test_lua_member_func_6");
 	};;
 
+	g_test_func_set["test_lua_member_func_bound"] = [L]()->bool
+	{
+		lua_tinker::class_def<ff, LUATINKER_BIND(&ff::test_memfn)>(L, "test_memfn_bound");
+		lua_tinker::class_def<ff, LUATINKER_BIND(&ff::test_const)>(L, "test_const_bound");
+		lua_tinker::class_def<ff, LUATINKER_BIND(&ff::add)>(L, "add_bound", 3);
+		lua_tinker::class_def<ff, LUATINKER_BIND(&ff_base::test_base_callfn)>(L, "test_base_callfn_bound");
+		std::string luabuf =
+			R"(function test_lua_member_func_bound()
+					local pFF = get_gff_ptr();
+					pFF:setVal(0);
+					pFF:add_bound(1);
+					pFF:add_bound();	--default 3
+					return pFF:test_memfn_bound() and get_gff_cref():test_const_bound() and pFF:getVal() == 4
+						and pFF:test_base_callfn_bound(7) == 7;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return lua_tinker::call<bool>(L, "test_lua_member_func_bound");
+	};
+
 
 
 }
\ No newline at end of file
@@ -11,6 +11,37 @@ bool test_tuple(std::tuple<int, int> tuple)
 	return std::get<0>(tuple) == 8 && std::get<1>(tuple) == 9;
 }
 
+lua_tinker::multi_return<int, float, bool> push_multi_return(int n)
+{
+	return { n, 2.5f, true };
+}
+
+lua_tinker::multi_return<std::string, int> push_multi_return_tuple()
+{
+	return std::make_tuple(std::string("a"), 3);
+}
+
+bool query_out_params(int nId, lua_tinker::out<int> nCount, lua_tinker::out<std::string> strName)
+{
+	nCount = *nCount + nId;
+	strName = "name" + std::to_string(nId);
+	return true;
+}
+
+void add_out_param(int nValue, lua_tinker::out<int> nSum)
+{
+	*nSum += nValue;
+}
+
+struct multi_return_class
+{
+	lua_tinker::multi_return<int, int> get_pair(lua_tinker::out<int> nOut) const
+	{
+		nOut = 3;
+		return { 1, 2 };
+	}
+};
+
 void test_multireturn(lua_State* L)
 {
 	g_test_func_set["test_lua_multireturn"] = [L]()->bool
@@ -90,4 +121,30 @@ void test_multireturn(lua_State* L)
 		return lua_tinker::call<bool>(L, "test_get_tuple");
 	};
 
+	g_test_func_set["test_lua_multi_return"] = [L]()->bool
+	{
+		lua_tinker::def(L, "push_multi_return", &push_multi_return);
+		lua_tinker::def(L, "push_multi_return_tuple", &push_multi_return_tuple);
+		lua_tinker::def(L, "query_out_params", &query_out_params);
+		lua_tinker::def<LUATINKER_BIND(&add_out_param)>(L, "add_out_param");
+		lua_tinker::class_add<multi_return_class>(L, "multi_return_class");
+		lua_tinker::class_con<multi_return_class>(L, lua_tinker::constructor<multi_return_class>::invoke);
+		lua_tinker::class_def<multi_return_class>(L, "get_pair", &multi_return_class::get_pair);
+		std::string luabuf =
+			R"(function test_lua_multi_return()
+					local a, b, c = push_multi_return(7);
+					local s, n = push_multi_return_tuple();
+					local ok, count, name = query_out_params(5, 10);
+					local ok2, count2, name2 = query_out_params(1);
+					local sum = add_out_param(2, 40);
+					local x, y, z = multi_return_class():get_pair();
+					return a == 7 and b == 2.5 and c == true and s == "a" and n == 3
+						and ok == true and count == 15 and name == "name5" and ok2 == true and count2 == 1 and name2 == "name1"
+						and sum == 42 and x == 1 and y == 2 and z == 3;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+
+		return lua_tinker::call<bool>(L, "test_lua_multi_return");
+	};
 }
@@ -0,0 +1,60 @@
+#include "lua_tinker.h"
+#include"test.h"
+extern std::map<std::string, std::function<bool()> > g_test_func_set;
+
+std::vector<float> g_num_array_vec = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f };
+
+lua_tinker::num_array<float> get_num_array()
+{
+	return g_num_array_vec;
+}
+
+double sum_num_array(lua_tinker::num_array<double> arr)
+{
+	double fSum = 0;
+	for (auto v : arr)
+		fSum += v;
+	return fSum;
+}
+
+size_t size_num_vector(std::vector<double> vec)
+{
+	return vec.size();
+}
+
+void test_num_array(lua_State* L)
+{
+	g_test_func_set["test_lua_num_array"] = [L]()->bool
+	{
+		lua_tinker::num_array_def<double>(L, "double_array");
+		lua_tinker::num_array_def<float>(L, "float_array");
+		lua_tinker::def(L, "get_num_array", &get_num_array);
+		lua_tinker::def(L, "sum_num_array", &sum_num_array);
+		lua_tinker::def(L, "size_num_vector", &size_num_vector);
+		std::string luabuf =
+			R"(function test_lua_num_array()
+					local a = double_array({1, 2, 3, 4, 5, 6, 7, 8, 9});
+					local b = double_array(9);
+					if #a ~= 9 or a[1] ~= 1 or a[10] ~= nil or b[9] ~= 0 then return false; end
+					for i = 1, #b do b[i] = 1; end
+					if a:sum() ~= 45 or a:dot(b) ~= 45 or a:min() ~= 1 or a:max() ~= 9 then return false; end
+					b:axpy(2, a):scale(0.5);
+					if b[9] ~= 9.5 or b:sum() ~= 49.5 then return false; end
+					a:clamp(3, 7);
+					if a[1] ~= 3 or a[9] ~= 7 then return false; end
+					local g = a:gather({9, 1});
+					if #g ~= 2 or g[1] ~= 7 or g[2] ~= 3 then return false; end
+					b:scatter({1, 2}, double_array({-1, -2}));
+					if b[1] ~= -1 or b[2] ~= -2 or #b:totable() ~= 9 then return false; end
+					if pcall(function() b[10] = 1; end) or pcall(function() a:dot(g); end) then return false; end
+					local ok, err = pcall(double_array, math.maxinteger);
+					if ok or not string.find(err, "too large") or pcall(float_array, math.maxinteger // 2) then return false; end
+					local c = get_num_array();
+					c[5] = 10;
+					return c:sum() == 20 and sum_num_array(a) == a:sum() and size_num_vector(a) == 9 and size_num_vector({1, 2}) == 2;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return lua_tinker::call<bool>(L, "test_lua_num_array") && g_num_array_vec[4] == 10.0f;
+	};
+}
@@ -107,4 +107,17 @@ void test_lua_intoptest(lua_State* L)
 
 		return lua_tinker::call<bool>(L, "test_lua_intoptest7");
 	};
-}
\ No newline at end of file
+
+	g_test_func_set["test_lua_intoptest_inline_value"] = [L]()->bool
+	{
+		//value obj is stored in the userdata block itself
+		lua_tinker::detail::push(L, IntOpTest(9));
+		auto* pWapper = lua_tinker::detail::user2type<lua_tinker::detail::UserDataWapper*>(L, -1);
+		const char* pBegin = (const char*)lua_touserdata(L, -1);
+		const char* pEnd = pBegin + lua_rawlen(L, -1);
+		const char* pObj = (const char*)pWapper->m_p;
+		bool bResult = pObj >= pBegin && pObj + sizeof(IntOpTest) <= pEnd && ((IntOpTest*)pWapper->m_p)->m_n == 9;
+		lua_pop(L, 1);
+		return bResult;
+	};
+}
@@ -51,6 +51,70 @@ std::string vector_join_const(const std::vector<int>& vec, const std::string& se
 	return result;
 }
 
+std::vector<uint8_t> make_bytes(int n)
+{
+	std::vector<uint8_t> vec;
+	for (int i = 0; i < n; i++)
+		vec.push_back((uint8_t)i);
+	return vec;
+}
+
+int sum_bytes(const std::vector<uint8_t>& vec)
+{
+	int nSum = 0;
+	for (auto v : vec)
+		nSum += v;
+	return nSum;
+}
+
+std::vector<char> echo_chars(std::vector<char> vec)
+{
+	return vec;
+}
+
+std::array<uint8_t, 4> make_bytes_array4()
+{
+	return std::array<uint8_t, 4>{ { 1, 0, 2, 255 } };
+}
+
+std::vector<int> g_view_vec = { 1, 2, 3 };
+std::map<std::string, int> g_view_map;
+std::vector<std::vector<int>> g_view_nested = { { 1, 2 }, { 3, 4 } };
+
+lua_tinker::view<std::vector<int>&> get_view_vec()
+{
+	return g_view_vec;
+}
+
+lua_tinker::view<const std::vector<int>&> get_view_vec_const()
+{
+	return g_view_vec;
+}
+
+lua_tinker::view<std::map<std::string, int>&> get_view_map()
+{
+	return g_view_map;
+}
+
+lua_tinker::view<std::vector<std::vector<int>>&> get_view_nested()
+{
+	return g_view_nested;
+}
+
+std::vector<ff*> g_view_ptr_vec;
+lua_tinker::view<std::vector<ff*>&> get_view_ptr_vec()
+{
+	g_view_ptr_vec.assign(2, get_gff_ptr());
+	return g_view_ptr_vec;
+}
+
+int sum_view(lua_tinker::view<const std::vector<int>&> v)
+{
+	int nSum = 0;
+	for (auto n : *v.m_p)
+		nSum += n;
+	return nSum;
+}
 
 void test_stl_container(lua_State* L)
 {
@@ -271,4 +335,58 @@ void test_stl_container(lua_State* L)
 		return val == "1,2,3,4,5";
 	};
 
-}
\ No newline at end of file
+
+	g_test_func_set["test_lua_byte_container"] = [L]()->bool
+	{
+		lua_tinker::def(L, "make_bytes", &make_bytes);
+		lua_tinker::def(L, "sum_bytes", &sum_bytes);
+		lua_tinker::def(L, "echo_chars", &echo_chars);
+		lua_tinker::def(L, "make_bytes_array4", &make_bytes_array4);
+		std::string luabuf =
+			R"(function test_lua_byte_container()
+					local s = make_bytes(300);
+					local a = make_bytes_array4();
+					local sum = 0;
+					for i = 1, #s do sum = sum + s:byte(i); end
+					return type(s) == "string" and #s == 300 and s:byte(1) == 0 and s:byte(257) == 0 and s:byte(300) == 43
+						and sum_bytes(s) == sum and sum_bytes({1, 2, 3}) == 6
+						and echo_chars("a\0b") == "a\0b" and a == "\1\0\2\255";
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return lua_tinker::call<bool>(L, "test_lua_byte_container");
+	};
+	g_test_func_set["test_lua_view"] = [L]()->bool
+	{
+		lua_tinker::def(L, "get_view_vec", &get_view_vec);
+		lua_tinker::def(L, "get_view_vec_const", &get_view_vec_const);
+		lua_tinker::def(L, "get_view_map", &get_view_map);
+		lua_tinker::def(L, "get_view_nested", &get_view_nested);
+		lua_tinker::def(L, "get_view_ptr_vec", &get_view_ptr_vec);
+		lua_tinker::def(L, "sum_view", &sum_view);
+		std::string luabuf =
+			R"(function test_lua_view()
+					local v = get_view_vec();
+					if #v ~= 3 or v[2] ~= 2 or v[4] ~= nil or v.x ~= nil then return false; end
+					v[2] = 20;
+					local sum = 0;
+					for i, n in pairs(v) do sum = sum + i * n; end
+					local c = get_view_vec_const();
+					if pcall(function() c[1] = 5; end) or pcall(function() v[4] = 5; end) then return false; end
+					local m = get_view_map();
+					m.a = 1;
+					m.b = 2;
+					m.a = nil;
+					local nMap = 0;
+					for k, n in pairs(m) do nMap = nMap + n; end
+					local nested = get_view_nested();
+					nested[2][1] = 7;
+					local ptrs = get_view_ptr_vec();
+					if getmetatable(ptrs[1]) ~= ff or ptrs[2]:getVal() ~= get_gff_ptr():getVal() then return false; end
+					return sum == 50 and nMap == 2 and #m == 1 and m.b == 2 and sum_view(v) == 24 and sum_view(c) == 24 and #nested[1] == 2;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		return lua_tinker::call<bool>(L, "test_lua_view") && g_view_vec[1] == 20 && g_view_map.size() == 1 && g_view_nested[1][0] == 7;
+	};
+}
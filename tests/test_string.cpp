@@ -18,6 +18,29 @@ const std::string& push_string_ref()
 	return g_teststring;
 }
 
+size_t string_view_len(lua_tinker::string_view sv)
+{
+	return sv.size();
+}
+
+lua_tinker::string_view string_view_echo(const lua_tinker::string_view& sv)
+{
+	return sv;
+}
+
+size_t string_len(const std::string& str)
+{
+	return str.size();
+}
+
+int string_map_sum(std::unordered_map<std::string, int> mapValue)
+{
+	int nSum = 0;
+	for (const auto& v : mapValue)
+		nSum += v.second;
+	return mapValue.count("1") ? nSum : -1;
+}
+
 void test_string(lua_State* L)
 {
 
@@ -42,6 +65,22 @@ void test_string(lua_State* L)
 		lua_tinker::dostring(L, luabuf.c_str());
 		return (g_teststring + g_teststring + g_teststring) == lua_tinker::call<std::string>(L, "test_lua_string_2", g_teststring);
 	};
+	g_test_func_set["test_lua_string_view"] = [L]()->bool
+	{
+		lua_tinker::def(L, "string_view_len", &string_view_len);
+		lua_tinker::def(L, "string_view_echo", &string_view_echo);
+		lua_tinker::def(L, "string_len", &string_len);
+		lua_tinker::def(L, "string_map_sum", &string_map_sum);
+		std::string luabuf =
+			R"(function test_lua_string_view(str)
+					return string_view_len("a\0b") == 3 and string_view_echo("a\0b") == "a\0b" and string_len("a\0b") == 3
+						and string_view_len(str) == #str and string_map_sum({[1] = 1, a = 2, b = 3}) == 6;
+				end
+			)";
+		lua_tinker::dostring(L, luabuf.c_str());
+		lua_tinker::string_view sv("test_string_view");
+		return lua_tinker::call<bool>(L, "test_lua_string_view", sv);
+	};
 
 
 